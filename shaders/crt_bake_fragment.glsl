@@ -0,0 +1,49 @@
+#version 330 core
+// Bakar CRT-effektens statiska delar till en uppslagstextur (RGBA16F), en texel per
+// utdatapixel. Körs bara när temat eller storleken ändras.
+//   rg: kurvaturens förskjutning av texturkoordinaten (böjd - rak)
+//   b:  scanlines * vinjett, 0 utanför den böjda skärmen
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform float scanlineIntensity; // 0.0 (av) - 1.0 (max)
+uniform float curvature;         // 0.0 (av) - ~0.5 (kraftig)
+
+// Funktion för att böja UV-koordinater för kurvatureffekt
+vec2 curveUV(vec2 uv, float curveAmount) {
+    // Konvertera till centrerade koordinater (-1 till 1)
+    uv = uv * 2.0 - 1.0;
+
+    // Applicera barrel distortion
+    float curve = curveAmount * 0.1; // Justera styrkan
+    vec2 offset = uv.yx * curve;
+    uv = uv + uv * offset * offset;
+
+    // Konvertera tillbaka till texturkoordinater (0 till 1)
+    uv = uv * 0.5 + 0.5;
+    return uv;
+}
+
+void main()
+{
+    vec2 curvedTexCoords = (curvature > 0.0) ? curveUV(TexCoords, curvature) : TexCoords;
+
+    // Svart utanför böjen
+    if (curvedTexCoords.x < 0.0 || curvedTexCoords.x > 1.0 || curvedTexCoords.y < 0.0 || curvedTexCoords.y > 1.0) {
+        FragColor = vec4(0.0);
+        return;
+    }
+
+    // Scanlines beräknade på den böjda y-koordinaten
+    float intensity = 1.0;
+    if (scanlineIntensity > 0.0) {
+        float scanLine = sin(curvedTexCoords.y * 600.0) * 0.5 + 0.5;
+        intensity = pow(scanLine, 2.0) * scanlineIntensity * 0.3 + (1.0 - scanlineIntensity * 0.3);
+    }
+
+    // Vinjettering, mer med mer kurvatur
+    float vignetteIntensity = 0.5 + curvature * 2.0;
+    float vignette = 1.0 - length((curvedTexCoords - 0.5) * 2.0) * vignetteIntensity * 0.2;
+
+    FragColor = vec4(curvedTexCoords - TexCoords, intensity * vignette, 1.0);
+}
@@ -0,0 +1,31 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 FragColor;
+
+// Cellrutnätet som heltalstextur: r = glyph-slot, g = fg-index, b = bg-index, a = flaggor
+uniform usampler2D grid;
+// Glyph-atlasen (monokrom, använder bara R-kanalen)
+uniform sampler2D text;
+
+uniform vec2 gridSize;      // Antal kolumner och rader
+uniform vec2 atlasGrid;     // Antal slots per rad och kolumn i glyph-atlasen
+uniform ivec2 cellPixels;   // Slotens storlek i atlasen (pixlar)
+uniform vec3 palette[16];   // Temats palett
+
+void main()
+{
+    // Vilken cell pixeln tillhör och var i cellen den ligger
+    vec2 cellPos = TexCoords * gridSize;
+    ivec2 cell = min(ivec2(cellPos), ivec2(gridSize) - 1);
+    vec2 inCell = clamp(cellPos - vec2(cell), 0.0, 1.0);
+
+    uvec4 c = texelFetch(grid, cell, 0);
+
+    // Hämta täckningen direkt ur glyphens slot i atlasen
+    uint columns = uint(atlasGrid.x);
+    ivec2 slot = ivec2(int(c.r % columns), int(c.r / columns));
+    ivec2 texel = slot * cellPixels + min(ivec2(inCell * vec2(cellPixels)), cellPixels - 1);
+    float alpha = texelFetch(text, texel, 0).r;
+
+    FragColor = vec4(mix(palette[c.b], palette[c.g], alpha), 1.0);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+// Helskärms-quad utan vertexbuffert: hörnen räknas fram ur gl_VertexID (triangle strip)
+out vec2 TexCoords; // 0,0 = övre vänstra hörnet av rutnätet
+
+void main()
+{
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    gl_Position = vec4(corner.x * 2.0 - 1.0, 1.0 - corner.y * 2.0, 0.0, 1.0);
+    TexCoords = corner;
+}
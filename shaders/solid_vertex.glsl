@@ -1,12 +1,32 @@
 #version 330 core
-layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords> behåller samma layout som text_shader
+// Per-instans-attribut: en rektangel per instans, quadens hörn från gl_VertexID
+layout (location = 0) in vec4 aRect;  // x, y, bredd, höjd (i de enheter projection mappar från)
+layout (location = 1) in vec4 aColor; // RGBA
+layout (location = 2) in uint aFlags;
 
 // Projektionsmatris för att mappa till skärmkoordinater
 uniform mat4 projection;
+// Blink: sekunder sedan blinkfasens nollpunkt och halvperiod (0 = ingen blink)
+uniform float time;
+uniform float blinkInterval;
+
+flat out vec4 rectColor;
+
+const uint BLINK = 0x01u;
 
 void main()
 {
-    // OBSERVERA: Vi behåller samma vertex layout som i text-shadern
-    // men ignorerar texturkoordinaterna (vertex.zw)
-    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+    // Blinkande rektanglar är dolda varannan halvperiod, med start i den synliga
+    bool blinkedOut = (aFlags & BLINK) != 0u && blinkInterval > 0.0
+                      && mod(floor(time / blinkInterval), 2.0) >= 1.0;
+    if (blinkedOut) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        rectColor = vec4(0.0);
+        return;
+    }
+
+    // Triangle strip: 0,0 1,0 0,1 1,1
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    gl_Position = projection * vec4(aRect.xy + corner * aRect.zw, 0.0, 1.0);
+    rectColor = aColor;
 }
@@ -1,14 +1,37 @@
 #version 330 core
-layout (location = 0) in vec2 aPos; // Förvänta oss direkt 2D NDC-position
-layout (location = 1) in vec2 aTexCoords; // Texturkoordinater (u,v)
+// Per-instans-attribut: en instans per cell i rutnätet
+layout (location = 0) in uvec2 aCell;   // Kolumn, rad
+layout (location = 1) in uvec4 aGlyph;  // Glyph-slot, fg-index, bg-index, flaggor
 
-out vec2 TexCoords; // Skicka vidare till fragment shader
+out vec2 TexCoords;     // Skicka vidare till fragment shader
+flat out vec3 textColor;
 
-// uniform mat4 projection; // BORTTAGEN
+uniform vec2 gridSize;      // Antal kolumner och rader
+uniform vec2 atlasGrid;     // Antal slots per rad och kolumn i glyph-atlasen
+uniform vec3 palette[16];   // Temats palett
+
+const uint HIDDEN = 0x80u; // Flagga för tomma celler
 
 void main()
 {
-    // Skicka positionen direkt vidare, anta att den redan är i NDC
-    gl_Position = vec4(aPos.x, aPos.y, 0.0, 1.0);
-    TexCoords = aTexCoords; // Skicka texturkoordinaterna vidare
+    // Tomma celler kollapsas till en degenererad quad utanför skärmen
+    if ((aGlyph.w & HIDDEN) != 0u) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        TexCoords = vec2(0.0);
+        textColor = vec3(0.0);
+        return;
+    }
+
+    // Quadens hörn räknas fram ur gl_VertexID (triangle strip: 0,0 1,0 0,1 1,1)
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+
+    // Cellposition i NDC, rad 0 är högst upp (nära NDC +1)
+    vec2 cellPos = (vec2(aCell) + corner) / gridSize;
+    gl_Position = vec4(cellPos.x * 2.0 - 1.0, 1.0 - cellPos.y * 2.0, 0.0, 1.0);
+
+    // Glyphens slot i atlasen; bearing och baslinje är redan inbakade i sloten
+    vec2 slot = vec2(float(aGlyph.x % uint(atlasGrid.x)), float(aGlyph.x / uint(atlasGrid.x)));
+    TexCoords = (slot + corner) / atlasGrid;
+
+    textColor = palette[aGlyph.y];
 }
@@ -0,0 +1,70 @@
+#include "CellCodec.h"
+
+namespace CellCodec {
+
+namespace {
+constexpr uint8_t kAttributes = 0x80; // fg, bg, flags (2 byte) för cellerna som följer
+constexpr uint8_t kCodepoint = 0x81;  // Tecken utanför ASCII som varint
+}
+
+void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool getVarint(const uint8_t*& in, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 35; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+void encode(const Cell* cells, size_t count, Cell& state, std::vector<uint8_t>& out) {
+    for (size_t i = 0; i < count; ++i) {
+        const Cell& cell = cells[i];
+        if (cell.fg != state.fg || cell.bg != state.bg || cell.flags != state.flags) {
+            out.push_back(kAttributes);
+            out.push_back(cell.fg);
+            out.push_back(cell.bg);
+            out.push_back(static_cast<uint8_t>(cell.flags));
+            out.push_back(static_cast<uint8_t>(cell.flags >> 8));
+            state = cell;
+        }
+        if (cell.codepoint < 0x80) {
+            out.push_back(static_cast<uint8_t>(cell.codepoint));
+        } else {
+            out.push_back(kCodepoint);
+            putVarint(out, cell.codepoint);
+        }
+    }
+}
+
+bool decode(const uint8_t*& in, const uint8_t* end, size_t count, Cell& state, std::vector<Cell>& out) {
+    for (size_t i = 0; i < count; ++i) {
+        if (in < end && *in == kAttributes) {
+            if (end - in < 5) return false;
+            state.fg = in[1];
+            state.bg = in[2];
+            state.flags = static_cast<uint16_t>(in[3] | (in[4] << 8));
+            in += 5;
+        }
+        if (in >= end) return false;
+        Cell cell = state;
+        if (*in == kCodepoint) {
+            ++in;
+            if (!getVarint(in, end, cell.codepoint)) return false;
+        } else {
+            cell.codepoint = *in++;
+        }
+        out.push_back(cell);
+    }
+    return true;
+}
+
+} // namespace CellCodec
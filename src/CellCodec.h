@@ -0,0 +1,27 @@
+#ifndef CELL_CODEC_H
+#define CELL_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CellGrid.h"
+
+// Kompakt bytekod för celler, för historik i minnet och på disk.
+//
+// En byte per cell med ASCII-tecken. Byte av färger/attribut och tecken utanför
+// ASCII skrivs som escape-koder, så text med samma färger kostar en byte per tecken.
+// state är fg, bg och flags som gäller före första cellen; den uppdateras så att
+// flera anrop i följd kan dela på den (eller börja om från Cell{} för fristående rader).
+namespace CellCodec {
+
+void putVarint(std::vector<uint8_t>& out, uint32_t value);
+bool getVarint(const uint8_t*& in, const uint8_t* end, uint32_t& value);
+
+void encode(const Cell* cells, size_t count, Cell& state, std::vector<uint8_t>& out);
+// Läser count celler från in och lägger dem sist i out. false om koden tar slut i förtid.
+bool decode(const uint8_t*& in, const uint8_t* end, size_t count, Cell& state, std::vector<Cell>& out);
+
+} // namespace CellCodec
+
+#endif // CELL_CODEC_H
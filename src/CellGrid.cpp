@@ -0,0 +1,21 @@
+#include "CellGrid.h"
+#include <algorithm>
+
+void CellGrid::resize(int cols_, int rows_, const Cell& fill) {
+    columnCount = cols_ > 0 ? cols_ : 0;
+    rowCount = rows_ > 0 ? rows_ : 0;
+    head = 0;
+    cells.assign(static_cast<size_t>(columnCount) * rowCount, fill);
+}
+
+void CellGrid::fillRow(int y, const Cell& fill) {
+    if (y < 0 || y >= rowCount) return;
+    std::fill_n(row(y), columnCount, fill);
+}
+
+void CellGrid::scrollUp(const Cell& fill) {
+    if (rowCount == 0) return;
+    // Den översta raden blir den nya sista
+    head = head + 1 < rowCount ? head + 1 : 0;
+    fillRow(rowCount - 1, fill);
+}
@@ -0,0 +1,56 @@
+#ifndef CELL_GRID_H
+#define CELL_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// En cell i rutnätet: tecken, färger och attribut i 8 byte.
+// Färgerna är index i temats palett (16 färger), så de ryms direkt i cellen i stället
+// för som id i en separat stiltabell.
+struct Cell {
+    uint32_t codepoint = ' ';
+    uint8_t fg = 0;     // Förgrundsfärg, palettindex
+    uint8_t bg = 0;     // Bakgrundsfärg, palettindex
+    uint16_t flags = 0; // Attribut (inga används ännu)
+};
+static_assert(sizeof(Cell) == 8, "Cell ska vara 8 byte så att en rad om 80 celler ryms i 10 cacherader");
+
+// Terminalens rutnät som en sammanhängande array, rad för rad.
+// row(y) pekar på radens första cell; raden har cols() celler i följd.
+//
+// Raderna ligger i en ring: y är logisk rad (0 överst på skärmen) och head anger
+// vilken lagrad rad som är överst. En scroll flyttar head och rensar en rad, oavsett
+// hur många rader rutnätet har. Efter varandra följande logiska rader ligger alltså
+// inte nödvändigtvis i följd i minnet.
+class CellGrid {
+public:
+    // Ny storlek, alla celler sätts till fill
+    void resize(int cols, int rows, const Cell& fill);
+
+    int cols() const { return columnCount; }
+    int rows() const { return rowCount; }
+
+    Cell* row(int y) { return &cells[storedRow(y) * columnCount]; }
+    const Cell* row(int y) const { return &cells[storedRow(y) * columnCount]; }
+    Cell& at(int x, int y) { return row(y)[x]; }
+    const Cell& at(int x, int y) const { return row(y)[x]; }
+
+    void fillRow(int y, const Cell& fill);
+    // Flytta alla rader ett steg upp (O(1) + en rad); den nya sista raden fylls med fill
+    void scrollUp(const Cell& fill);
+
+private:
+    std::vector<Cell> cells;
+    int columnCount = 0;
+    int rowCount = 0;
+    int head = 0; // Lagrad rad som visas överst
+
+    size_t storedRow(int y) const {
+        int stored = head + y;
+        if (stored >= rowCount) stored -= rowCount;
+        return static_cast<size_t>(stored);
+    }
+};
+
+#endif // CELL_GRID_H
@@ -0,0 +1,110 @@
+#include "DamageTracker.h"
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+
+void DamageTracker::resize(int rows_) {
+    rows = rows_ > 0 ? rows_ : 0;
+    bits.assign((rows + 63) / 64, 0);
+    dirtyRows = 0;
+    scrolled = 0;
+    full = true; // Ny storlek betyder att allt måste ritas om
+}
+
+void DamageTracker::markRow(int row) {
+    if (full || row < 0 || row >= rows) return;
+    uint64_t mask = uint64_t(1) << (row & 63);
+    uint64_t& word = bits[row >> 6];
+    if (!(word & mask)) {
+        word |= mask;
+        dirtyRows++;
+    }
+}
+
+void DamageTracker::markRows(int firstRow, int lastRow) {
+    for (int row = firstRow; row <= lastRow; ++row) {
+        markRow(row);
+    }
+}
+
+void DamageTracker::markAll() {
+    full = true;
+}
+
+void DamageTracker::scroll(int lines) {
+    if (full || lines == 0) return;
+    if (std::abs(scrolled + lines) >= rows || std::abs(lines) >= rows) {
+        markAll(); // Inget av det ritade finns kvar på skärmen
+        return;
+    }
+    scrolled += lines;
+
+    // Flytta bitarna lines steg mot rad 0 (eller bort från den), ett ord åt gången
+    const size_t words = bits.size();
+    const int distance = std::abs(lines);
+    const size_t wordShift = static_cast<size_t>(distance) >> 6;
+    const int bitShift = distance & 63;
+    dirtyRows = 0;
+    if (lines > 0) {
+        for (size_t w = 0; w < words; ++w) {
+            size_t src = w + wordShift;
+            uint64_t word = src < words ? bits[src] >> bitShift : 0;
+            if (bitShift != 0 && src + 1 < words) {
+                word |= bits[src + 1] << (64 - bitShift);
+            }
+            bits[w] = word;
+            dirtyRows += static_cast<int>(std::bitset<64>(word).count());
+        }
+    } else {
+        for (size_t w = words; w-- > 0;) {
+            uint64_t word = 0;
+            if (w >= wordShift) {
+                size_t src = w - wordShift;
+                word = bits[src] << bitShift;
+                if (bitShift != 0 && src > 0) {
+                    word |= bits[src - 1] >> (64 - bitShift);
+                }
+            }
+            // Bitar bortom sista raden räknas inte
+            if (w == words - 1 && (rows & 63) != 0) {
+                word &= (uint64_t(1) << (rows & 63)) - 1;
+            }
+            bits[w] = word;
+            dirtyRows += static_cast<int>(std::bitset<64>(word).count());
+        }
+    }
+    if (lines > 0) {
+        markRows(rows - lines, rows - 1);
+    } else {
+        markRows(0, -lines - 1);
+    }
+}
+
+bool DamageTracker::isRowDirty(int row) const {
+    if (row < 0 || row >= rows) return false;
+    if (full) return true;
+    return (bits[row >> 6] >> (row & 63)) & 1;
+}
+
+bool DamageTracker::nextDirtyRun(int row, int& first, int& count) const {
+    while (row < rows && !isRowDirty(row)) {
+        // Hoppa över hela tomma ord direkt
+        if (!full && (row & 63) == 0 && bits[row >> 6] == 0) {
+            row += 64;
+            continue;
+        }
+        row++;
+    }
+    if (row >= rows) return false;
+    first = row;
+    while (row < rows && isRowDirty(row)) row++;
+    count = row - first;
+    return true;
+}
+
+void DamageTracker::clear() {
+    std::fill(bits.begin(), bits.end(), 0);
+    dirtyRows = 0;
+    scrolled = 0;
+    full = false;
+}
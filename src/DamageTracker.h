@@ -0,0 +1,43 @@
+#ifndef DAMAGE_TRACKER_H
+#define DAMAGE_TRACKER_H
+
+#include <vector>
+#include <cstdint>
+
+// Håller reda på vilka rader i rutnätet som ändrats sedan senaste frame.
+// En bit per rad, plus en flagga för hela skärmen (temabyte, storleksändring).
+// Scroll räknas separat, så att renderaren kan flytta det som redan är ritat.
+class DamageTracker {
+public:
+    void resize(int rows);
+
+    void markRow(int row);
+    void markRows(int firstRow, int lastRow); // Inklusive båda
+    void markAll();
+    // Innehållet har flyttats lines rader uppåt (nedåt om lines är negativt). Smutsiga
+    // rader följer med och de nya raderna som kommit in blir smutsiga.
+    void scroll(int lines);
+
+    bool isFull() const { return full; }
+    bool isRowDirty(int row) const;
+    bool any() const { return full || dirtyRows > 0; }
+    // Antal rader som behöver laddas upp (alla vid full skada)
+    int dirtyRowCount() const { return full ? rows : dirtyRows; }
+    // Rader som allt redan ritat ska flyttas uppåt, negativt nedåt (0 vid full skada)
+    int scrolledRows() const { return full ? 0 : scrolled; }
+
+    // Nästa sammanhängande följd av smutsiga rader från och med row.
+    // Returnerar false när inga fler finns; first/count anger följden.
+    bool nextDirtyRun(int row, int& first, int& count) const;
+
+    void clear();
+
+private:
+    std::vector<uint64_t> bits;
+    int rows = 0;
+    int dirtyRows = 0;
+    int scrolled = 0;
+    bool full = true;
+};
+
+#endif // DAMAGE_TRACKER_H
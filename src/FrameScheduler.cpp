@@ -0,0 +1,51 @@
+#include "FrameScheduler.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+
+void FrameScheduler::configure(Mode mode, double refreshRate, double fpsCap) {
+    currentMode = mode;
+    refreshPeriod = refreshRate > 0.0 ? 1.0 / refreshRate : 1.0 / 60.0;
+    capPeriod = fpsCap > 0.0 ? 1.0 / fpsCap : refreshPeriod;
+    lastVsync = lastStart = -1.0;
+    costs.fill(0.0);
+    LOG_INFO("Frame scheduler: %s, refresh %.2f Hz", mode == Mode::VSync ? "vsync" : "capped",
+             1.0 / (mode == Mode::VSync ? refreshPeriod : capPeriod));
+}
+
+double FrameScheduler::renderCost() const {
+    return *std::max_element(costs.begin(), costs.end());
+}
+
+double FrameScheduler::renderStartTime(double now) const {
+    if (currentMode == Mode::Capped) {
+        return lastStart < 0.0 ? now : std::max(now, lastStart + capPeriod);
+    }
+    double budget = renderCost() + kSafetyMargin;
+    if (lastVsync < 0.0 || budget >= refreshPeriod) {
+        return now; // Ingen uppskattning än, eller renderingen tar hela perioden
+    }
+    // Första vsync som fortfarande går att hinna till
+    double periods = std::ceil((now + budget - lastVsync) / refreshPeriod);
+    double vsync = lastVsync + std::max(periods, 1.0) * refreshPeriod;
+    return std::max(now, vsync - budget);
+}
+
+void FrameScheduler::frameSubmitted(double time) {
+    costs[costIndex] = time - frameStart;
+    costIndex = (costIndex + 1) % kCostHistory;
+    lastStart = frameStart;
+}
+
+void FrameScheduler::frameSwapped(double time) {
+    if (currentMode != Mode::VSync) return;
+    // Mätta intervall nära en period förfinar perioden; missade frames och pauser hoppas över
+    if (lastVsync >= 0.0) {
+        double interval = time - lastVsync;
+        if (interval > refreshPeriod * 0.75 && interval < refreshPeriod * 1.25) {
+            refreshPeriod += (interval - refreshPeriod) * 0.05;
+        }
+    }
+    lastVsync = time;
+}
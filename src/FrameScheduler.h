@@ -0,0 +1,47 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <array>
+
+// Bestämmer när nästa frame ska börja renderas.
+//
+// Med vsync väntar loopen till strax före nästa förväntade vsync (senast uppmätta
+// renderingskostnad plus marginal) och läser input först då, så att en knapptryckning
+// som kommer under väntan hinner med i samma frame i stället för nästa.
+// Vsync-tidpunkterna uppskattas från när glfwSwapBuffers returnerar.
+// Utan vsync begränsas takten till ett mål-FPS.
+// Alla tider är sekunder från glfwGetTime().
+class FrameScheduler {
+public:
+    enum class Mode { VSync, Capped };
+
+    static constexpr int kCostHistory = 16;      // Frames som renderingskostnaden räknas över
+    static constexpr double kSafetyMargin = 0.002; // Marginal före vsync för drivrutin och GPU
+
+    void configure(Mode mode, double refreshRate, double fpsCap);
+
+    Mode mode() const { return currentMode; }
+    int swapInterval() const { return currentMode == Mode::VSync ? 1 : 0; }
+    double period() const { return refreshPeriod; }
+    // Dyraste renderingen bland de senaste framesen
+    double renderCost() const;
+
+    // Tidigaste tidpunkt då nästa frame bör börja renderas (now om det är bråttom)
+    double renderStartTime(double now) const;
+
+    void frameStarted(double time) { frameStart = time; }
+    void frameSubmitted(double time); // Precis innan glfwSwapBuffers
+    void frameSwapped(double time);   // När glfwSwapBuffers returnerat
+
+private:
+    Mode currentMode = Mode::VSync;
+    double refreshPeriod = 1.0 / 60.0;
+    double capPeriod = 0.0;
+    double lastVsync = -1.0;   // Senaste uppskattade vsync, < 0 innan första framen
+    double lastStart = -1.0;   // När förra framen började (för FPS-taket)
+    double frameStart = 0.0;
+    std::array<double, kCostHistory> costs{};
+    int costIndex = 0;
+};
+
+#endif // FRAME_SCHEDULER_H
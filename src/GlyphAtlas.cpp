@@ -0,0 +1,103 @@
+#include "GlyphAtlas.h"
+#include <iostream>
+#include <algorithm>
+
+bool GlyphAtlas::build(FT_Face face, int cellWidth_, int cellHeight_) {
+    if (!face || cellWidth_ <= 0 || cellHeight_ <= 0) return false;
+
+    cellWidth = cellWidth_;
+    cellHeight = cellHeight_;
+    atlasWidth = kColumns * cellWidth;
+    atlasHeight = kRows * cellHeight;
+    pixels.assign(static_cast<size_t>(atlasWidth) * atlasHeight, 0);
+
+    // Baslinjen ligger på fontens ascender räknat från slotens överkant
+    int baseline = static_cast<int>(face->size->metrics.ascender >> 6);
+    baseline = std::min(std::max(baseline, 0), cellHeight);
+
+    for (int slot = 0; slot < kGlyphCount; ++slot) {
+        Glyph& g = glyphs[slot];
+        int sx = slot % kColumns;
+        int sy = slot / kColumns;
+        g = Glyph();
+        g.u0 = static_cast<float>(sx * cellWidth) / atlasWidth;
+        g.u1 = static_cast<float>((sx + 1) * cellWidth) / atlasWidth;
+        g.v0 = static_cast<float>(sy * cellHeight) / atlasHeight;
+        g.v1 = static_cast<float>((sy + 1) * cellHeight) / atlasHeight;
+    }
+
+    // Ladda teckenglyphs för ASCII 0-127
+    for (int c = 0; c < 128; ++c) {
+        if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
+            std::cerr << "Warning::FREETYPE: Failed to load Glyph: " << c << std::endl;
+            continue;
+        }
+        const FT_GlyphSlot ftGlyph = face->glyph;
+        Glyph& g = glyphs[c];
+        g.width = static_cast<int>(ftGlyph->bitmap.width);
+        g.height = static_cast<int>(ftGlyph->bitmap.rows);
+        g.bearingX = ftGlyph->bitmap_left;
+        g.bearingY = ftGlyph->bitmap_top;
+        g.advance = static_cast<int>(ftGlyph->advance.x >> 6); // advance i pixlar
+        g.present = true;
+        blitBitmap(c, ftGlyph->bitmap, g.bearingX, baseline - g.bearingY);
+    }
+
+    // Fyllt block (CP437 219) för markören, oberoende av om fonten har det
+    fillSlot(kFullBlock, 255);
+    Glyph& block = glyphs[kFullBlock];
+    block.width = cellWidth;
+    block.height = cellHeight;
+    block.bearingY = baseline;
+    block.advance = cellWidth;
+    block.present = true;
+    return true;
+}
+
+bool GlyphAtlas::upload() {
+    if (pixels.empty()) return false;
+
+    // Ladda upp hela atlasen som en textur
+    if (textureID == 0) glGenTextures(1, &textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Inaktivera byte-alignment restriction
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Använd GL_NEAREST för pixel-perfekt retro-look
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return true;
+}
+
+void GlyphAtlas::destroy() {
+    if (textureID != 0) {
+        glDeleteTextures(1, &textureID);
+        textureID = 0;
+    }
+}
+
+void GlyphAtlas::blitBitmap(int slot, const FT_Bitmap& bitmap, int left, int top) {
+    int originX = (slot % kColumns) * cellWidth;
+    int originY = (slot / kColumns) * cellHeight;
+    for (int row = 0; row < static_cast<int>(bitmap.rows); ++row) {
+        int y = top + row;
+        if (y < 0 || y >= cellHeight) continue; // Klipp mot slotens kanter
+        const unsigned char* src = bitmap.buffer + row * bitmap.pitch;
+        for (int col = 0; col < static_cast<int>(bitmap.width); ++col) {
+            int x = left + col;
+            if (x < 0 || x >= cellWidth) continue;
+            pixels[static_cast<size_t>(originY + y) * atlasWidth + originX + x] = src[col];
+        }
+    }
+}
+
+void GlyphAtlas::fillSlot(int slot, uint8_t value) {
+    int originX = (slot % kColumns) * cellWidth;
+    int originY = (slot / kColumns) * cellHeight;
+    for (int y = 0; y < cellHeight; ++y) {
+        std::fill_n(pixels.begin() + static_cast<size_t>(originY + y) * atlasWidth + originX, cellWidth, value);
+    }
+}
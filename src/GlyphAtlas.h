@@ -0,0 +1,67 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// FreeType för att rastrera glyphs
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+// Alla glyphs packade i en enda GL_RED-textur.
+// Varje glyph får en cellstor slot (cellWidth x cellHeight) där bitmapen redan är
+// placerad enligt bearing och baslinje, så en cell ritas alltid som en hel slot.
+class GlyphAtlas {
+public:
+    // Slots indexeras med tecknets byte-värde (CP437-ordning). 0-127 laddas från fonten,
+    // 219 är det fyllda blocket som används för markören.
+    static constexpr int kGlyphCount = 256;
+    static constexpr int kColumns = 16;
+    static constexpr int kRows = kGlyphCount / kColumns;
+    static constexpr unsigned char kFullBlock = 219;
+
+    struct Glyph {
+        // Slotens rektangel i atlasen (normaliserade texturkoordinater, v0 = överkant)
+        float u0 = 0.0f, v0 = 0.0f, u1 = 0.0f, v1 = 0.0f;
+        // Fontmetrik i pixlar (samma som FreeType rapporterar)
+        int width = 0;
+        int height = 0;
+        int bearingX = 0;
+        int bearingY = 0;
+        int advance = 0;
+        bool present = false; // false om glyphen inte kunde laddas
+    };
+
+    // Rastrera glyphs från face till CPU-kopian (ingen GL behövs)
+    bool build(FT_Face face, int cellWidth, int cellHeight);
+    // Ladda upp CPU-kopian som textur. Kräver aktiv GL-kontext.
+    bool upload();
+    // Frigör GL-texturen (CPU-kopian behålls)
+    void destroy();
+
+    GLuint texture() const { return textureID; }
+    const Glyph& glyph(unsigned char c) const { return glyphs[c]; }
+
+    int getCellWidth() const { return cellWidth; }
+    int getCellHeight() const { return cellHeight; }
+    int getWidth() const { return atlasWidth; }
+    int getHeight() const { return atlasHeight; }
+    // Atlasens pixlar (8 bitar täckning per pixel, rad 0 = överkant)
+    const std::vector<uint8_t>& getPixels() const { return pixels; }
+
+private:
+    GLuint textureID = 0;
+    int cellWidth = 0;
+    int cellHeight = 0;
+    int atlasWidth = 0;
+    int atlasHeight = 0;
+    Glyph glyphs[kGlyphCount];
+    std::vector<uint8_t> pixels;
+
+    void blitBitmap(int slot, const FT_Bitmap& bitmap, int left, int top);
+    void fillSlot(int slot, uint8_t value);
+};
+
+#endif // GLYPH_ATLAS_H
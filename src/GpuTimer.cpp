@@ -0,0 +1,125 @@
+#include "GpuTimer.h"
+#include "Log.h"
+
+#include <algorithm>
+
+bool GpuTimer::create() {
+    glGenQueries(kFramesInFlight * kStageCount, &queries[0][0]);
+    return queries[0][0] != 0;
+}
+
+void GpuTimer::destroy() {
+    if (!enabled()) return;
+    glDeleteQueries(kFramesInFlight * kStageCount, &queries[0][0]);
+    for (int frame = 0; frame < kFramesInFlight; ++frame) {
+        std::fill(std::begin(queries[frame]), std::end(queries[frame]), 0u);
+        std::fill(std::begin(pending[frame]), std::end(pending[frame]), false);
+    }
+}
+
+void GpuTimer::beginFrame() {
+    if (!enabled()) return;
+    collect();
+    slot = (slot + 1) % kFramesInFlight;
+    // Slotens resultat från kFramesInFlight frames sedan är inte klara: hoppa över framen
+    recording = !framePending(slot);
+    if (recording) {
+        frameTotalMs[slot] = 0.0;
+    } else {
+        skippedFrames++;
+    }
+}
+
+bool GpuTimer::framePending(int frame) const {
+    return std::any_of(std::begin(pending[frame]), std::end(pending[frame]), [](bool p) { return p; });
+}
+
+void GpuTimer::begin(Stage stage) {
+    if (!recording) return;
+    end(); // Steg kan inte nästlas; ett nytt steg avslutar det förra
+    int index = static_cast<int>(stage);
+    glBeginQuery(GL_TIME_ELAPSED, queries[slot][index]);
+    pending[slot][index] = true;
+    activeStage = index;
+}
+
+void GpuTimer::end() {
+    if (activeStage < 0) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    activeStage = -1;
+}
+
+void GpuTimer::endFrame() {
+    end();
+    recording = false;
+}
+
+// Läs de resultat som finns, utan att vänta. Queries blir klara i den ordning de
+// skickades, så äldsta framen först och sluta vid första som inte är klar.
+void GpuTimer::collect() {
+    for (int age = kFramesInFlight - 1; age >= 0; --age) {
+        int frame = (slot + kFramesInFlight - age) % kFramesInFlight;
+        for (int stage = 0; stage < kStageCount; ++stage) {
+            if (!pending[frame][stage]) continue;
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(queries[frame][stage], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return;
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(queries[frame][stage], GL_QUERY_RESULT, &nanoseconds);
+            pending[frame][stage] = false;
+
+            double ms = nanoseconds / 1.0e6;
+            frameTotalMs[frame] += ms;
+            if (!framePending(frame)) {
+                lastFrameMs = frameTotalMs[frame]; // Framens sista steg
+            }
+
+            History& h = history[stage];
+            h.ms[h.next] = ms;
+            h.next = (h.next + 1) % kHistory;
+            if (h.count < kHistory) h.count++;
+        }
+    }
+}
+
+GpuTimer::Stats GpuTimer::stats(Stage stage) const {
+    const History& h = history[static_cast<int>(stage)];
+    Stats s;
+    s.samples = h.count;
+    if (h.count == 0) return s;
+    s.lastMs = h.ms[(h.next + kHistory - 1) % kHistory];
+    double total = 0.0;
+    for (size_t i = 0; i < h.count; ++i) {
+        total += h.ms[i];
+        s.maxMs = std::max(s.maxMs, h.ms[i]);
+    }
+    s.avgMs = total / h.count;
+    return s;
+}
+
+const char* GpuTimer::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::Clear: return "clear";
+        case Stage::Scroll: return "scroll";
+        case Stage::Background: return "background";
+        case Stage::Text: return "text";
+        case Stage::Cursor: return "cursor";
+        case Stage::CRT: return "crt";
+        case Stage::Hud: return "hud";
+        case Stage::Count: break;
+    }
+    return "?";
+}
+
+void GpuTimer::report() const {
+    for (int i = 0; i < kStageCount; ++i) {
+        Stage stage = static_cast<Stage>(i);
+        Stats s = stats(stage);
+        if (s.samples == 0) continue;
+        LOG_INFO("GPU %s: last %.3f ms, avg %.3f ms, max %.3f ms (%zu frames)", stageName(stage),
+                 s.lastMs, s.avgMs, s.maxMs, s.samples);
+    }
+    if (skippedFrames > 0) {
+        LOG_INFO("GPU timers skipped %zu frames while results were pending", skippedFrames);
+    }
+}
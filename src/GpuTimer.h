@@ -0,0 +1,72 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <array>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+// GPU-tid per renderingssteg med GL_TIME_ELAPSED-queries (--gpu-timers).
+//
+// Varje steg har en query per frame i en ring om kFramesInFlight frames. Resultat
+// läses först när GL_QUERY_RESULT_AVAILABLE säger att de finns, så CPU:n väntar
+// aldrig på GPU:n. Ligger GPU:n så långt efter att ringen är full mäts inte framen.
+// Mätvärdena sparas i ett rullande fönster om kHistory frames per steg.
+class GpuTimer {
+public:
+    enum class Stage { Clear, Scroll, Background, Text, Cursor, CRT, Hud, Count };
+    static constexpr int kStageCount = static_cast<int>(Stage::Count);
+    static constexpr int kFramesInFlight = 4;
+    static constexpr int kHistory = 120;
+
+    struct Stats {
+        double lastMs = 0.0;
+        double avgMs = 0.0;
+        double maxMs = 0.0;
+        size_t samples = 0; // Antal i fönstret
+    };
+
+    GpuTimer() = default;
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // Kräver aktiv GL-kontext
+    bool create();
+    void destroy();
+    bool enabled() const { return queries[0][0] != 0; }
+
+    // Runt varje renderTerminal(). Steg kan inte nästlas (bara en GL_TIME_ELAPSED åt gången).
+    void beginFrame();
+    void begin(Stage stage);
+    void end();
+    void endFrame();
+
+    Stats stats(Stage stage) const;
+    // Summan av alla steg för den senast färdigmätta framen, ms
+    double frameMs() const { return lastFrameMs; }
+    static const char* stageName(Stage stage);
+    // Skriv senaste/medel/max per steg till loggen
+    void report() const;
+
+private:
+    struct History {
+        std::array<double, kHistory> ms{};
+        size_t count = 0;
+        size_t next = 0;
+    };
+
+    GLuint queries[kFramesInFlight][kStageCount] = {};
+    bool pending[kFramesInFlight][kStageCount] = {};
+    int slot = 0;
+    bool recording = false; // Framen mäts (ringens slot var ledig)
+    int activeStage = -1;
+    std::array<History, kStageCount> history;
+    double frameTotalMs[kFramesInFlight] = {}; // Hittills inlästa steg per slot
+    double lastFrameMs = 0.0;
+    size_t skippedFrames = 0;
+
+    bool framePending(int frame) const;
+    void collect();
+};
+
+#endif // GPU_TIMER_H
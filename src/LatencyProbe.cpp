@@ -0,0 +1,64 @@
+#include "LatencyProbe.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LatencyProbe::inputEvent(double time) {
+    if (active) pending.push_back(time);
+}
+
+void LatencyProbe::frameSwapped(double time) {
+    if (!active || pending.empty()) return;
+    for (double input : pending) {
+        swapSamples.push_back(time - input);
+    }
+    Frame frame;
+    frame.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame.inputs.swap(pending);
+    frames.push_back(std::move(frame));
+    glFlush(); // Se till att fencen skickas även om loopen somnar
+}
+
+void LatencyProbe::poll(double time) {
+    while (!frames.empty()) {
+        GLint status = GL_UNSIGNALED;
+        glGetSynciv(frames.front().sync, GL_SYNC_STATUS, 1, NULL, &status);
+        if (status != GL_SIGNALED) break;
+        for (double input : frames.front().inputs) {
+            gpuSamples.push_back(time - input);
+        }
+        glDeleteSync(frames.front().sync);
+        frames.pop_front();
+    }
+}
+
+// Närmaste rang på en sorterad kopia; anropas bara vid rapportering
+double LatencyProbe::percentile(Metric metric, double p) const {
+    std::vector<double> sorted = samples(metric);
+    if (sorted.empty()) return 0.0;
+    std::sort(sorted.begin(), sorted.end());
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    rank = std::clamp<size_t>(rank, 1, sorted.size());
+    return sorted[rank - 1] * 1000.0;
+}
+
+void LatencyProbe::report() const {
+    const struct { Metric metric; const char* name; } rows[] = {
+        { Metric::Swap, "input -> swap" },
+        { Metric::GpuDone, "input -> GPU done" },
+    };
+    for (const auto& row : rows) {
+        LOG_INFO("Latency %s: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms (%zu samples)", row.name,
+                 percentile(row.metric, 50.0), percentile(row.metric, 95.0), percentile(row.metric, 99.0),
+                 percentile(row.metric, 100.0), sampleCount(row.metric));
+    }
+}
+
+void LatencyProbe::destroy() {
+    for (Frame& frame : frames) {
+        glDeleteSync(frame.sync);
+    }
+    frames.clear();
+    pending.clear();
+}
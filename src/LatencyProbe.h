@@ -0,0 +1,69 @@
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Mäter fördröjningen från input till bild (--latency-probe).
+//
+// Input-callbacks stämplar varje händelse. Stämplarna väntar tills nästa frame
+// visas, då räknas tiden fram till att glfwSwapBuffers returnerat. En fence efter
+// swappen ger också tiden tills GPU:n ritat klart framen; den pollas utan att vänta,
+// så upplösningen är huvudloopens pollintervall (kPollInterval).
+// Alla tider är sekunder från glfwGetTime().
+class LatencyProbe {
+public:
+    static constexpr double kPollInterval = 0.001;
+
+    enum class Metric { Swap, GpuDone };
+
+    LatencyProbe() = default;
+    LatencyProbe(const LatencyProbe&) = delete;
+    LatencyProbe& operator=(const LatencyProbe&) = delete;
+
+    void enable() { active = true; }
+    bool enabled() const { return active; }
+
+    // En input som ändrar bilden har tagits emot
+    void inputEvent(double time);
+    // Anropas direkt efter glfwSwapBuffers. Kräver aktiv GL-kontext.
+    void frameSwapped(double time);
+    // Kontrollera fences för visade frames (väntar aldrig)
+    void poll(double time);
+
+    // Visade frames vars GPU-arbete inte är klart än
+    bool waitingOnGpu() const { return !frames.empty(); }
+    // Ingen input väntar på att visas och ingen frame väntar på GPU:n
+    bool idle() const { return pending.empty() && frames.empty(); }
+
+    size_t sampleCount(Metric metric) const { return samples(metric).size(); }
+    // Percentil (0-100) i millisekunder, 0 utan mätvärden
+    double percentile(Metric metric, double p) const;
+
+    // Skriv p50/p95/p99/max för båda mätpunkterna till loggen
+    void report() const;
+
+    // Släpp utestående fences (kräver aktiv GL-kontext)
+    void destroy();
+
+private:
+    struct Frame {
+        GLsync sync = nullptr;
+        std::vector<double> inputs; // Stämplar som först syns i denna frame
+    };
+
+    bool active = false;
+    std::vector<double> pending;
+    std::deque<Frame> frames; // Äldst först
+    std::vector<double> swapSamples; // Sekunder
+    std::vector<double> gpuSamples;
+
+    const std::vector<double>& samples(Metric metric) const {
+        return metric == Metric::Swap ? swapSamples : gpuSamples;
+    }
+};
+
+#endif // LATENCY_PROBE_H
@@ -0,0 +1,174 @@
+#include "LineStore.h"
+#include "CellCodec.h"
+#include "Log.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Indexposten: offset i datafilen i de låga 48 bitarna, radens längd i byte i de höga 16
+constexpr int kLengthShift = 48;
+constexpr uint64_t kOffsetMask = (uint64_t(1) << kLengthShift) - 1;
+constexpr size_t kEntrySize = sizeof(uint64_t);
+constexpr size_t kMaxRecord = 0xFFFF;
+}
+
+LineStore::~LineStore() {
+    close();
+}
+
+#ifndef _WIN32
+
+bool LineStore::MappedFile::open(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open scrollback file %s: %s", path.c_str(), std::strerror(errno));
+        return false;
+    }
+    length = 0;
+    return true;
+}
+
+void LineStore::MappedFile::close() {
+    for (Window& window : windows) {
+        if (window.memory) munmap(window.memory, kSegmentSize);
+        window = Window{};
+    }
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    length = 0;
+}
+
+uint8_t* LineStore::MappedFile::segment(size_t number, bool grow) {
+    // Redan mappat?
+    Window* oldest = &windows[0];
+    for (Window& window : windows) {
+        if (window.memory && window.segment == number) {
+            window.lastUse = ++useCounter;
+            return window.memory;
+        }
+        if (!window.memory || (oldest->memory && window.lastUse < oldest->lastUse)) oldest = &window;
+    }
+
+    size_t end = (number + 1) * kSegmentSize;
+    if (end > length) {
+        if (!grow) return nullptr;
+        // Filen blir gles; sidorna får diskutrymme först när de skrivs
+        if (ftruncate(fd, static_cast<off_t>(end)) != 0) {
+            LOG_ERROR("Cannot grow scrollback file: %s", std::strerror(errno));
+            return nullptr;
+        }
+        length = end;
+    }
+
+    // Ersätt det fönster som använts minst nyligen
+    if (oldest->memory) munmap(oldest->memory, kSegmentSize);
+    void* memory = mmap(nullptr, kSegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                        static_cast<off_t>(number * kSegmentSize));
+    if (memory == MAP_FAILED) {
+        LOG_ERROR("Cannot map scrollback segment %zu: %s", number, std::strerror(errno));
+        *oldest = Window{};
+        return nullptr;
+    }
+    oldest->segment = number;
+    oldest->memory = static_cast<uint8_t*>(memory);
+    oldest->lastUse = ++useCounter;
+    return oldest->memory;
+}
+
+#else
+
+bool LineStore::MappedFile::open(const std::string& path) {
+    LOG_ERROR("Disk-backed scrollback (%s) needs mmap and is not available on this platform", path.c_str());
+    return false;
+}
+
+void LineStore::MappedFile::close() {
+    fd = -1;
+    length = 0;
+}
+
+uint8_t* LineStore::MappedFile::segment(size_t, bool) {
+    return nullptr;
+}
+
+#endif
+
+size_t LineStore::MappedFile::mappedBytes() const {
+    size_t bytes = 0;
+    for (const Window& window : windows) {
+        if (window.memory) bytes += kSegmentSize;
+    }
+    return bytes;
+}
+
+bool LineStore::open(const std::string& path) {
+    close();
+    if (!data.open(path) || !index.open(path + ".idx")) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void LineStore::close() {
+    data.close();
+    index.close();
+    lineCount = 0;
+    writeOffset = 0;
+}
+
+void LineStore::append(const Cell* cells, int count) {
+    if (!isOpen()) return;
+    code.clear();
+    Cell state; // Varje rad för sig, så den kan läsas utan raderna före
+    CellCodec::encode(cells, static_cast<size_t>(count), state, code);
+    if (code.size() > kMaxRecord) {
+        LOG_WARN("Scrollback line of %zu bytes is too long for the index, dropped", code.size());
+        return;
+    }
+
+    // Raden ska ligga i ett segment
+    size_t offsetInSegment = writeOffset % kSegmentSize;
+    if (offsetInSegment + code.size() > kSegmentSize) {
+        writeOffset += kSegmentSize - offsetInSegment;
+    }
+    uint8_t* segment = data.segment(writeOffset / kSegmentSize, true);
+    size_t entryOffset = lineCount * kEntrySize;
+    uint8_t* entries = index.segment(entryOffset / kSegmentSize, true);
+    if (!segment || !entries) return;
+
+    std::memcpy(segment + writeOffset % kSegmentSize, code.data(), code.size());
+    uint64_t entry = (static_cast<uint64_t>(code.size()) << kLengthShift) | writeOffset;
+    std::memcpy(entries + entryOffset % kSegmentSize, &entry, kEntrySize);
+    writeOffset += code.size();
+    lineCount++;
+}
+
+bool LineStore::line(size_t number, std::vector<Cell>& out) const {
+    out.clear();
+    if (number >= lineCount) return false;
+    size_t entryOffset = number * kEntrySize;
+    const uint8_t* entries = index.segment(entryOffset / kSegmentSize, false);
+    if (!entries) return false;
+    uint64_t entry;
+    std::memcpy(&entry, entries + entryOffset % kSegmentSize, kEntrySize);
+    size_t offset = static_cast<size_t>(entry & kOffsetMask);
+    size_t length = static_cast<size_t>(entry >> kLengthShift);
+
+    const uint8_t* segment = data.segment(offset / kSegmentSize, false);
+    if (!segment) return false;
+    const uint8_t* in = segment + offset % kSegmentSize;
+    const uint8_t* end = in + length;
+    Cell state;
+    while (in < end) {
+        if (!CellCodec::decode(in, end, 1, state, out)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef LINE_STORE_H
+#define LINE_STORE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CellGrid.h"
+
+// Historik på disk för sessioner utan radgräns (--scrollback-file=FIL).
+//
+// Två filer som bara växer: FIL med varje rads bytekod (CellCodec, fristående per rad)
+// och FIL.idx med en uint64 per rad (offset i FIL och längd). Rad i hittas alltså med
+// en läsning i indexet, oavsett hur lång historiken är.
+//
+// Filerna läses och skrivs genom minnesmappade segment om kSegmentSize byte. Högst
+// kWindows segment per fil är mappade samtidigt, så det residenta minnet är begränsat
+// och resten ligger i sidcachen, där kärnan kan skriva ut och släppa det.
+// En rad delas aldrig mellan två segment; får den inte plats börjar den i nästa.
+// Filerna töms när de öppnas. Kräver mmap (POSIX).
+class LineStore {
+public:
+    static constexpr size_t kSegmentSize = 4 * 1024 * 1024;
+    static constexpr int kWindows = 2;
+
+    LineStore() = default;
+    ~LineStore();
+    LineStore(const LineStore&) = delete;
+    LineStore& operator=(const LineStore&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return data.fd >= 0; }
+
+    void append(const Cell* cells, int count);
+    size_t size() const { return lineCount; }
+    // Rad index (0 = äldsta) till out
+    bool line(size_t index, std::vector<Cell>& out) const;
+
+    // Byte som används i filerna (de förlängs ett segment i taget och är glesa)
+    size_t fileBytes() const { return writeOffset + lineCount * sizeof(uint64_t); }
+    size_t mappedBytes() const { return data.mappedBytes() + index.mappedBytes(); }
+
+private:
+    // Fil som mappas ett segment i taget. Segment bortom filens slut läggs till
+    // (filen förlängs) när de mappas för skrivning.
+    struct MappedFile {
+        struct Window {
+            size_t segment = 0;
+            uint8_t* memory = nullptr;
+            uint64_t lastUse = 0;
+        };
+        int fd = -1;
+        size_t length = 0; // Filens storlek, hela segment
+        std::array<Window, kWindows> windows{};
+        uint64_t useCounter = 0;
+
+        bool open(const std::string& path);
+        void close();
+        // Segmentets minne, eller nullptr om det inte finns (eller inte kunde mappas)
+        uint8_t* segment(size_t number, bool grow);
+        size_t mappedBytes() const;
+    };
+
+    mutable MappedFile data, index;
+    size_t lineCount = 0;
+    size_t writeOffset = 0; // Nästa lediga byte i datafilen
+    std::vector<uint8_t> code;
+};
+
+#endif // LINE_STORE_H
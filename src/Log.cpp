@@ -0,0 +1,145 @@
+#include "Log.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Log {
+
+namespace {
+
+// Begränsad lås-fri kö (Vyukov): flera producenter, en konsument (skrivartråden).
+// Varje slot har ett sekvensnummer som säger om den är ledig eller fylld.
+constexpr size_t kCapacity = 1024; // Måste vara en tvåpotens
+
+struct Slot {
+    std::atomic<size_t> sequence{0};
+    Level level = Level::Info;
+    const char* format = nullptr;
+    Formatter formatter = nullptr;
+    alignas(std::max_align_t) unsigned char payload[kPayloadSize];
+};
+
+Slot slots[kCapacity];
+std::atomic<size_t> enqueuePos{0};
+size_t dequeuePos = 0; // Ägs av skrivartråden
+std::atomic<size_t> dropped{0};
+
+std::thread writer;
+std::atomic<bool> running{false};
+std::atomic<bool> writerSleeping{false};
+std::mutex sleepMutex;
+std::condition_variable wakeup;
+
+struct SlotInit {
+    SlotInit() {
+        for (size_t i = 0; i < kCapacity; ++i) slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+} slotInit;
+
+const char* levelName(Level level) {
+    switch (level) {
+        case Level::Trace: return "TRACE";
+        case Level::Debug: return "DEBUG";
+        case Level::Info:  return "INFO";
+        case Level::Warn:  return "WARN";
+        case Level::Error: return "ERROR";
+    }
+    return "?";
+}
+
+// Skriver ut ett meddelande om ett finns. Körs bara på skrivartråden (eller efter join).
+bool drainOne() {
+    Slot& slot = slots[dequeuePos & (kCapacity - 1)];
+    size_t seq = slot.sequence.load(std::memory_order_acquire);
+    if (seq != dequeuePos + 1) return false; // Tom (eller producenten är inte klar än)
+
+    char message[512];
+    slot.formatter(slot.format, slot.payload, message, sizeof(message));
+    FILE* out = slot.level >= Level::Warn ? stderr : stdout;
+    std::fprintf(out, "[%s] %s\n", levelName(slot.level), message);
+
+    slot.sequence.store(dequeuePos + kCapacity, std::memory_order_release);
+    dequeuePos++;
+    return true;
+}
+
+void writerLoop() {
+    while (running.load(std::memory_order_acquire)) {
+        bool wrote = false;
+        while (drainOne()) wrote = true;
+        if (wrote) {
+            std::fflush(stdout);
+            continue;
+        }
+        // Inget att göra: sov tills en producent väcker oss. Timeouten täcker
+        // den sällsynta väckning som kan missas eftersom producenter aldrig tar låset.
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        writerSleeping.store(true, std::memory_order_seq_cst);
+        if (!drainOne()) {
+            wakeup.wait_for(lock, std::chrono::milliseconds(250));
+        }
+        writerSleeping.store(false, std::memory_order_seq_cst);
+    }
+    while (drainOne()) {}
+    std::fflush(stdout);
+}
+
+} // namespace
+
+void start() {
+    if (running.exchange(true)) return;
+    writer = std::thread(writerLoop);
+    // Se till att tråden avslutas även om main() returnerar utan att anropa stop()
+    static bool registered = (std::atexit(stop), true);
+    (void)registered;
+}
+
+void stop() {
+    if (!running.exchange(false)) return;
+    wakeup.notify_one();
+    writer.join();
+    size_t lost = dropped.load();
+    if (lost > 0) {
+        std::fprintf(stderr, "[WARN] %zu log messages dropped (queue full)\n", lost);
+    }
+}
+
+size_t droppedCount() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+bool enqueue(Level level, const char* format, Formatter formatter,
+             void (*construct)(void* slot, const void* args), const void* args) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;) {
+        slot = &slots[pos & (kCapacity - 1)];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed); // Kön är full
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->format = format;
+    slot->formatter = formatter;
+    construct(slot->payload, args);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    if (writerSleeping.load(std::memory_order_seq_cst)) {
+        wakeup.notify_one();
+    }
+    return true;
+}
+
+} // namespace Log
@@ -0,0 +1,167 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Loggning med nivåfiltrering vid kompilering och asynkron skrivning.
+//
+// Nivåer under DARKTERM_LOG_LEVEL kompileras bort (argumenten evalueras inte, men
+// typkontrolleras fortfarande så att de inte blir oanvända variabler).
+// Aktiva nivåer kopierar bara argumenten till en lås-fri kö; formatering (printf-stil)
+// och I/O sker på en bakgrundstråd, så render-tråden aldrig blockeras av stdout.
+// Formatsträngen kontrolleras mot argumenten vid kompilering (GCC/Clang).
+// Är kön full kastas meddelandet och räknas i stället för att vänta.
+
+#define DARKTERM_LOG_LEVEL_TRACE 0
+#define DARKTERM_LOG_LEVEL_DEBUG 1
+#define DARKTERM_LOG_LEVEL_INFO  2
+#define DARKTERM_LOG_LEVEL_WARN  3
+#define DARKTERM_LOG_LEVEL_ERROR 4
+#define DARKTERM_LOG_LEVEL_OFF   5
+
+#ifndef DARKTERM_LOG_LEVEL
+#define DARKTERM_LOG_LEVEL DARKTERM_LOG_LEVEL_INFO
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DARKTERM_PRINTF_FORMAT(formatIndex, firstArg) __attribute__((format(printf, formatIndex, firstArg)))
+#else
+#define DARKTERM_PRINTF_FORMAT(formatIndex, firstArg)
+#endif
+
+namespace Log {
+
+enum class Level : uint8_t { Trace, Debug, Info, Warn, Error };
+
+// Strängargument kopieras så att anroparens buffert får försvinna direkt. Längre
+// strängar trunkeras och slutar då med "..." så att det syns i loggen.
+struct Str {
+    static constexpr size_t kCapacity = 128;
+    char text[kCapacity];
+};
+
+constexpr size_t kPayloadSize = 2 * Str::kCapacity + 64; // Två strängar och några tal
+using Formatter = void (*)(const char* format, const void* payload, char* out, size_t outSize);
+
+// Starta/stoppa skrivartråden. stop() skriver ut allt som ligger kvar i kön.
+void start();
+void stop();
+
+// Antal meddelanden som kastats för att kön var full
+size_t droppedCount();
+
+// Lägger ett meddelande i kön. Payload konstrueras på plats av construct().
+bool enqueue(Level level, const char* format, Formatter formatter,
+             void (*construct)(void* slot, const void* args), const void* args);
+
+namespace detail {
+
+inline Str toStr(const char* s) {
+    Str out;
+    if (!s) s = "(null)";
+    std::strncpy(out.text, s, Str::kCapacity - 1);
+    out.text[Str::kCapacity - 1] = '\0';
+    if (std::strlen(s) >= Str::kCapacity) {
+        std::memcpy(out.text + Str::kCapacity - 4, "...", 4);
+    }
+    return out;
+}
+
+// Anropas aldrig; finns bara för att kompilatorn ska kontrollera formatsträngen
+// mot argumenten (printf-attributet kräver en funktion med ...)
+void checkFormat(const char* format, ...) DARKTERM_PRINTF_FORMAT(1, 2);
+
+template <typename T>
+inline auto capture(const T& value) {
+    if constexpr (std::is_same_v<T, std::string>) {
+        return toStr(value.c_str());
+    } else if constexpr (std::is_convertible_v<const T&, const char*>) {
+        return toStr(value);
+    } else {
+        static_assert(std::is_trivially_copyable_v<T>, "Log arguments must be trivially copyable or strings");
+        return value;
+    }
+}
+
+template <typename T>
+inline const T& unwrap(const T& value) { return value; }
+inline const char* unwrap(const Str& value) { return value.text; }
+
+template <typename Tuple>
+void formatTuple(const char* format, const void* payload, char* out, size_t outSize) {
+    const Tuple& args = *static_cast<const Tuple*>(payload);
+    std::apply([&](const auto&... a) {
+        if constexpr (sizeof...(a) == 0) {
+            std::snprintf(out, outSize, "%s", format);
+        } else {
+            std::snprintf(out, outSize, format, unwrap(a)...);
+        }
+    }, args);
+}
+
+} // namespace detail
+
+template <typename... Args>
+void write(Level level, const char* format, const Args&... args) {
+    using Tuple = std::tuple<decltype(detail::capture(args))...>;
+    static_assert(sizeof(Tuple) <= kPayloadSize, "Too many/large log arguments");
+    static_assert(alignof(Tuple) <= alignof(std::max_align_t), "Over-aligned log arguments");
+
+    auto refs = std::forward_as_tuple(args...);
+    using Refs = decltype(refs);
+    enqueue(level, format, &detail::formatTuple<Tuple>,
+            [](void* slot, const void* source) {
+                const Refs& r = *static_cast<const Refs*>(source);
+                std::apply([slot](const auto&... a) { new (slot) Tuple(detail::capture(a)...); }, r);
+            },
+            &refs);
+}
+
+} // namespace Log
+
+// Aktiv nivå: kontrollera formatet och lägg meddelandet i kön. Avstängd nivå: bara
+// kontrollen, i en gren som aldrig körs, så argumenten används men inte evalueras.
+#define DARKTERM_LOG_CHECK(...) if constexpr (false) ::Log::detail::checkFormat(__VA_ARGS__)
+#define DARKTERM_LOG_ON(level, ...) \
+    do { DARKTERM_LOG_CHECK(__VA_ARGS__); ::Log::write(level, __VA_ARGS__); } while (0)
+#define DARKTERM_LOG_OFF(...) do { DARKTERM_LOG_CHECK(__VA_ARGS__); } while (0)
+
+#if DARKTERM_LOG_LEVEL <= DARKTERM_LOG_LEVEL_TRACE
+#define LOG_TRACE(...) DARKTERM_LOG_ON(::Log::Level::Trace, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) DARKTERM_LOG_OFF(__VA_ARGS__)
+#endif
+
+#if DARKTERM_LOG_LEVEL <= DARKTERM_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) DARKTERM_LOG_ON(::Log::Level::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) DARKTERM_LOG_OFF(__VA_ARGS__)
+#endif
+
+#if DARKTERM_LOG_LEVEL <= DARKTERM_LOG_LEVEL_INFO
+#define LOG_INFO(...) DARKTERM_LOG_ON(::Log::Level::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(...) DARKTERM_LOG_OFF(__VA_ARGS__)
+#endif
+
+#if DARKTERM_LOG_LEVEL <= DARKTERM_LOG_LEVEL_WARN
+#define LOG_WARN(...) DARKTERM_LOG_ON(::Log::Level::Warn, __VA_ARGS__)
+#else
+#define LOG_WARN(...) DARKTERM_LOG_OFF(__VA_ARGS__)
+#endif
+
+#if DARKTERM_LOG_LEVEL <= DARKTERM_LOG_LEVEL_ERROR
+#define LOG_ERROR(...) DARKTERM_LOG_ON(::Log::Level::Error, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) DARKTERM_LOG_OFF(__VA_ARGS__)
+#endif
+
+#endif // LOG_H
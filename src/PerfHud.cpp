@@ -0,0 +1,54 @@
+#include "PerfHud.h"
+
+#include <algorithm>
+#include <cstdio>
+
+void PerfHud::Graph::push(float value) {
+    values[next] = value;
+    next = (next + 1) % kSamples;
+}
+
+float PerfHud::Graph::max() const {
+    return *std::max_element(values.begin(), values.end());
+}
+
+// Bytes med enhet, kort nog för en rad i panelen
+static void formatBytes(char* out, size_t size, double bytes) {
+    if (bytes >= 1024.0 * 1024.0) {
+        std::snprintf(out, size, "%.1f MB", bytes / (1024.0 * 1024.0));
+    } else if (bytes >= 1024.0) {
+        std::snprintf(out, size, "%.1f KB", bytes / 1024.0);
+    } else {
+        std::snprintf(out, size, "%.0f B", bytes);
+    }
+}
+
+void PerfHud::frameFinished(const Counters& counters, double time) {
+    frameMs.push(static_cast<float>(counters.cpuMs));
+    if (lastFrame >= 0.0 && time > lastFrame) {
+        parseRate.push(static_cast<float>(parsedBytes / (time - lastFrame)));
+    }
+    parsedBytes = 0;
+    lastFrame = time;
+
+    char* timing = lines[static_cast<int>(Line::Timing)].data();
+    if (counters.gpuMs >= 0.0) {
+        std::snprintf(timing, kColumns + 1, "cpu %.2f ms  gpu %.2f ms", counters.cpuMs, counters.gpuMs);
+    } else {
+        std::snprintf(timing, kColumns + 1, "cpu %.2f ms  gpu --", counters.cpuMs);
+    }
+
+    char upload[10];
+    formatBytes(upload, sizeof(upload), static_cast<double>(counters.uploadedBytes));
+    std::snprintf(lines[static_cast<int>(Line::Counters)].data(), kColumns + 1, "draws %d  up %s  dirty %d",
+                  counters.drawCalls, upload, counters.dirtyRows);
+
+    std::snprintf(lines[static_cast<int>(Line::FrameLabel)].data(), kColumns + 1, "frame ms  max %.2f",
+                  frameMs.max());
+
+    char rate[10], peak[10];
+    formatBytes(rate, sizeof(rate), parseRate.at(kSamples - 1));
+    formatBytes(peak, sizeof(peak), parseRate.max());
+    std::snprintf(lines[static_cast<int>(Line::ParseLabel)].data(), kColumns + 1, "parse %s/s  max %s",
+                  rate, peak);
+}
@@ -0,0 +1,67 @@
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include <array>
+#include <cstddef>
+
+// Prestanda-HUD (F2, --hud): frametid och parse-genomströmning som grafer, plus
+// räknare för senaste framen (ritanrop, uppladdade bytes, smutsiga rader, CPU/GPU-tid).
+//
+// Klassen samlar bara mätvärden och formaterar texten. Panelen ritas i main.cpp med
+// solid-shadern (bakgrund och staplar) och glyph-atlasen (text), två ritanrop totalt.
+// Värdena gäller framen före den som visar dem.
+class PerfHud {
+public:
+    static constexpr int kSamples = 64;   // Staplar per graf
+    static constexpr int kColumns = 36;   // Panelens bredd i celler
+    static constexpr int kGraphRows = 3;  // Grafernas höjd i celler
+    static constexpr double kRefreshInterval = 0.25; // Sekunder mellan frames när inget annat ritas
+
+    enum class Line { Timing, Counters, FrameLabel, ParseLabel, Count };
+    static constexpr int kLineCount = static_cast<int>(Line::Count);
+
+    struct Counters {
+        int drawCalls = 0;
+        size_t uploadedBytes = 0;
+        int dirtyRows = 0;
+        double cpuMs = 0.0;
+        double gpuMs = -1.0; // < 0 om GPU-timers saknas
+    };
+
+    // Rullande fönster, äldsta värdet först
+    class Graph {
+    public:
+        void push(float value);
+        float at(int i) const { return values[(next + i) % kSamples]; }
+        float max() const;
+
+    private:
+        std::array<float, kSamples> values{};
+        int next = 0;
+    };
+
+    void toggle() { shown = !shown; }
+    void show() { shown = true; }
+    bool visible() const { return shown; }
+
+    // Terminalen har tolkat bytes (input eller utdata från ett program)
+    void parsed(size_t bytes) { parsedBytes += bytes; }
+    // En frame är färdigritad; time är sekunder från glfwGetTime()
+    void frameFinished(const Counters& counters, double time);
+
+    // När HUD:en senast behöver en ny frame för att inte stå still
+    double refreshTime() const { return lastFrame + kRefreshInterval; }
+
+    const Graph& frameGraph() const { return frameMs; }   // CPU-tid per frame, ms
+    const Graph& parseGraph() const { return parseRate; } // Bytes per sekund
+    const char* line(Line which) const { return lines[static_cast<int>(which)].data(); }
+
+private:
+    bool shown = false;
+    size_t parsedBytes = 0;  // Sedan förra framen
+    double lastFrame = -1.0; // < 0 innan första framen
+    Graph frameMs, parseRate;
+    std::array<std::array<char, kColumns + 1>, kLineCount> lines{};
+};
+
+#endif // PERF_HUD_H
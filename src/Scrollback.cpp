@@ -0,0 +1,280 @@
+#include "Scrollback.h"
+#include "CellCodec.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+using CellCodec::getVarint;
+using CellCodec::putVarint;
+
+// Blockets rader i följd: antal celler som varint och cellerna som bytekod. Färgerna
+// följer med mellan raderna, så bara ändringar kostar något.
+void encodeCells(const std::vector<Cell>& cells, const std::vector<uint32_t>& ends, std::vector<uint8_t>& out) {
+    Cell state;
+    uint32_t start = 0;
+    for (uint32_t end : ends) {
+        putVarint(out, end - start);
+        CellCodec::encode(cells.data() + start, end - start, state, out);
+        start = end;
+    }
+}
+
+bool decodeCells(const uint8_t* in, const uint8_t* end, int lines, std::vector<Cell>& cells,
+                 std::vector<uint32_t>& ends) {
+    Cell state;
+    for (int line = 0; line < lines; ++line) {
+        uint32_t count = 0;
+        if (!getVarint(in, end, count) || !CellCodec::decode(in, end, count, state, cells)) return false;
+        ends.push_back(static_cast<uint32_t>(cells.size()));
+    }
+    return true;
+}
+
+// LZ77 över bytekoden: omväxlande antal literaler, literalerna och en matchning
+// (längd - kMinMatch, avstånd bakåt), alla tal som varint. Sista sekvensen har bara
+// literaler. Matchningar hittas med en hashtabell över fyra byte.
+constexpr size_t kMinMatch = 4;
+constexpr int kHashBits = 12;
+constexpr size_t kMaxDistance = 65535;
+
+uint32_t hash4(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+void compress(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+    putVarint(out, static_cast<uint32_t>(in.size()));
+    std::vector<int32_t> table(size_t(1) << kHashBits, -1);
+    const uint8_t* base = in.data();
+    const size_t size = in.size();
+    size_t pos = 0, literalStart = 0;
+    while (pos + kMinMatch <= size) {
+        uint32_t h = hash4(base + pos);
+        int32_t candidate = table[h];
+        table[h] = static_cast<int32_t>(pos);
+        if (candidate < 0 || pos - static_cast<size_t>(candidate) > kMaxDistance ||
+            std::memcmp(base + candidate, base + pos, kMinMatch) != 0) {
+            pos++;
+            continue;
+        }
+        size_t length = kMinMatch;
+        while (pos + length < size && base[candidate + length] == base[pos + length]) length++;
+
+        putVarint(out, static_cast<uint32_t>(pos - literalStart));
+        out.insert(out.end(), base + literalStart, base + pos);
+        putVarint(out, static_cast<uint32_t>(length - kMinMatch));
+        putVarint(out, static_cast<uint32_t>(pos - candidate));
+        pos += length;
+        literalStart = pos;
+    }
+    putVarint(out, static_cast<uint32_t>(size - literalStart));
+    out.insert(out.end(), base + literalStart, base + size);
+}
+
+bool decompress(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+    const uint8_t* p = in.data();
+    const uint8_t* end = p + in.size();
+    uint32_t size = 0;
+    if (!getVarint(p, end, size)) return false;
+    out.clear();
+    out.reserve(size);
+    while (out.size() < size) {
+        uint32_t literals = 0;
+        if (!getVarint(p, end, literals) || static_cast<size_t>(end - p) < literals) return false;
+        out.insert(out.end(), p, p + literals);
+        p += literals;
+        if (out.size() >= size) break;
+
+        uint32_t length = 0, distance = 0;
+        if (!getVarint(p, end, length) || !getVarint(p, end, distance)) return false;
+        if (distance == 0 || distance > out.size()) return false;
+        // Byte för byte: matchningen får överlappa det den kopierar
+        size_t from = out.size() - distance;
+        for (size_t i = 0; i < length + kMinMatch; ++i) out.push_back(out[from + i]);
+    }
+    return out.size() == size;
+}
+
+} // namespace
+
+Scrollback::Scrollback(size_t limit) : maxLines(limit) {}
+
+Scrollback::~Scrollback() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+void Scrollback::setLimit(size_t lines) {
+    maxLines = lines;
+    trim();
+}
+
+bool Scrollback::openFile(const std::string& path) {
+    if (!store.open(path)) return false;
+    LOG_INFO("Scrollback is stored in %s", path.c_str());
+    return true;
+}
+
+void Scrollback::push(const Cell* row, int cols, const Cell& blank) {
+    int length = cols;
+    while (length > 0 && std::memcmp(&row[length - 1], &blank, sizeof(Cell)) == 0) length--;
+    if (store.isOpen()) {
+        store.append(row, length);
+        return;
+    }
+
+    if (maxLines == 0) return;
+    if (blocks.empty() || blocks.back()->lines == kBlockLines) {
+        auto block = std::make_shared<Block>();
+        block->id = nextId++;
+        blocks.push_back(std::move(block));
+        handOffOldBlocks();
+    }
+    Block& block = *blocks.back();
+    block.cells.insert(block.cells.end(), row, row + length);
+    block.ends.push_back(static_cast<uint32_t>(block.cells.size()));
+    block.lines++;
+    lineCount++;
+    trim();
+}
+
+// Lämna fulla block utöver de kHotBlocks senaste till tråden
+void Scrollback::handOffOldBlocks() {
+    size_t full = blocks.size() - 1; // Det sista blocket fylls fortfarande
+    if (full - handedOff <= static_cast<size_t>(kHotBlocks)) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (full - handedOff > static_cast<size_t>(kHotBlocks)) {
+            queue.push_back(blocks[handedOff++]);
+        }
+        if (!worker.joinable()) {
+            worker = std::thread(&Scrollback::workerLoop, this);
+        }
+    }
+    wake.notify_one();
+}
+
+void Scrollback::trim() {
+    while (lineCount > maxLines && !blocks.empty()) {
+        Block& front = *blocks.front();
+        size_t forget = std::min(lineCount - maxLines, front.lines - firstLine);
+        firstLine += forget;
+        lineCount -= forget;
+        forgottenLines += forget;
+        if (firstLine == static_cast<size_t>(front.lines) && blocks.size() > 1) {
+            blocks.pop_front(); // Packar tråden blocket just nu håller den en egen referens
+
+            firstLine = 0;
+            if (handedOff > 0) handedOff--;
+        } else if (maxLines == 0) {
+            blocks.clear();
+            firstLine = 0;
+            handedOff = 0;
+        }
+    }
+}
+
+void Scrollback::workerLoop() {
+    std::vector<uint8_t> code;
+    for (;;) {
+        BlockPtr block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) return;
+            block = std::move(queue.front());
+            queue.pop_front();
+        }
+        if (block.use_count() == 1) continue; // Redan glömt
+
+        // Ett block i kön ändras inte längre, så det kan läsas utan lås
+        code.clear();
+        encodeCells(block->cells, block->ends, code);
+        std::vector<uint8_t> packed;
+        compress(code, packed);
+        packed.shrink_to_fit();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        block->rawBytes = block->cells.size() * sizeof(Cell) + block->ends.size() * sizeof(uint32_t);
+        block->packed = std::move(packed);
+        block->cold = true;
+        std::vector<Cell>().swap(block->cells);
+        std::vector<uint32_t>().swap(block->ends);
+    }
+}
+
+bool Scrollback::line(size_t index, std::vector<Cell>& out) const {
+    if (store.isOpen()) return store.line(index, out);
+    out.clear();
+    if (index >= lineCount) return false;
+    index += firstLine;
+    const Block& block = *blocks[index / kBlockLines];
+    const int lineInBlock = static_cast<int>(index % kBlockLines);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const Block* source = &block;
+    if (block.cold) {
+        if (cached.id != block.id) {
+            std::vector<uint8_t> code;
+            cached.cells.clear();
+            cached.ends.clear();
+            cached.id = 0;
+            if (!decompress(block.packed, code) ||
+                !decodeCells(code.data(), code.data() + code.size(), block.lines, cached.cells, cached.ends)) {
+                LOG_ERROR("Scrollback block %llu is corrupt", static_cast<unsigned long long>(block.id));
+                return false;
+            }
+            cached.id = block.id;
+        }
+        source = &cached;
+    }
+    uint32_t start = lineInBlock > 0 ? source->ends[lineInBlock - 1] : 0;
+    out.assign(source->cells.begin() + start, source->cells.begin() + source->ends[lineInBlock]);
+    return true;
+}
+
+Scrollback::Stats Scrollback::stats() const {
+    Stats s;
+    s.lines = lineCount;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const BlockPtr& block : blocks) {
+        if (block->cold) {
+            s.coldBlocks++;
+            s.coldLines += block->lines;
+            s.coldBytes += block->packed.capacity();
+            s.rawBytes += block->rawBytes;
+        } else {
+            s.hotBlocks++;
+            s.hotBytes += block->cells.capacity() * sizeof(Cell) + block->ends.capacity() * sizeof(uint32_t);
+        }
+    }
+    return s;
+}
+
+void Scrollback::report() const {
+    if (store.isOpen()) {
+        size_t lines = store.size();
+        if (lines == 0) return;
+        LOG_INFO("Scrollback: %zu lines on disk in %.1f MB (%.1f KB per 100k lines), %.1f MB mapped",
+                 lines, store.fileBytes() / (1024.0 * 1024.0), store.fileBytes() * 100000.0 / lines / 1024.0,
+                 store.mappedBytes() / (1024.0 * 1024.0));
+        return;
+    }
+    Stats s = stats();
+    if (s.lines == 0) return;
+    LOG_INFO("Scrollback: %zu lines in %.1f KB; %zu hot blocks %.1f KB, %zu packed blocks %.1f KB",
+             s.lines, (s.hotBytes + s.coldBytes) / 1024.0, s.hotBlocks, s.hotBytes / 1024.0, s.coldBlocks,
+             s.coldBytes / 1024.0);
+    if (s.coldLines > 0) {
+        LOG_INFO("Scrollback packed: %.1f KB per 100k lines (%.1fx smaller than cells)",
+                 s.coldBytes * 100000.0 / s.coldLines / 1024.0, double(s.rawBytes) / s.coldBytes);
+    }
+}
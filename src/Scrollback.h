@@ -0,0 +1,108 @@
+#ifndef SCROLLBACK_H
+#define SCROLLBACK_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CellGrid.h"
+#include "LineStore.h"
+
+// Historik för rader som scrollat ut överst (--scrollback=N).
+//
+// Raderna sparas utan avslutande tomma celler i block om kBlockLines rader. De
+// kHotBlocks senaste blocken ligger kvar som celler. Äldre block packas av en
+// bakgrundstråd: först till en bytekod (en byte per ASCII-tecken, färgbyten bara där
+// de ändras) och sedan med en enkel LZ77 som tar hand om upprepningar mellan rader.
+// push() kopierar bara raden och lämnar fulla block till tråden, så den väntar
+// aldrig på komprimeringen.
+//
+// Blir historiken längre än gränsen glöms de äldsta raderna, hela block åt gången
+// så snart ett block bara innehåller glömda rader.
+//
+// Med openFile() (--scrollback-file=FIL) går alla rader i stället till en LineStore
+// på disk, utan gräns och med begränsat residentminne.
+class Scrollback {
+public:
+    static constexpr size_t kDefaultLimit = 100000;
+    static constexpr int kBlockLines = 256;
+    static constexpr int kHotBlocks = 4;
+
+    struct Stats {
+        size_t lines = 0;
+        size_t coldLines = 0; // Rader i packade block
+        size_t hotBlocks = 0, coldBlocks = 0;
+        size_t hotBytes = 0, coldBytes = 0; // Allokerat minne per form
+        size_t rawBytes = 0;                // Packade blockens storlek som celler
+    };
+
+    explicit Scrollback(size_t limit = kDefaultLimit);
+    ~Scrollback();
+    Scrollback(const Scrollback&) = delete;
+    Scrollback& operator=(const Scrollback&) = delete;
+
+    // Största antal rader i minnet; 0 stänger av historiken
+    void setLimit(size_t lines);
+    // Spara historiken på disk i stället, utan radgräns. false om filen inte gick att skapa.
+    bool openFile(const std::string& path);
+    size_t limit() const { return maxLines; }
+
+    // Spara en rad. Avslutande celler lika med blank sparas inte.
+    void push(const Cell* row, int cols, const Cell& blank);
+    size_t size() const { return store.isOpen() ? store.size() : lineCount; }
+    // Rader som glömts sedan start. forgotten() + index är radens nummer räknat från
+    // första raden som sparades, och ändras inte när äldre rader glöms.
+    size_t forgotten() const { return forgottenLines; }
+    // Rad index (0 = äldsta) till out, utan de avslutande tomma cellerna.
+    // Packade block packas upp och den senast lästa hålls kvar.
+    bool line(size_t index, std::vector<Cell>& out) const;
+
+    Stats stats() const;
+    // Minnesåtgång till loggen: totalt och per 100 000 packade rader
+    void report() const;
+
+private:
+    struct Block {
+        std::vector<Cell> cells;       // Radernas celler i följd (tom när blocket är packat)
+        std::vector<uint32_t> ends;    // Slutindex i cells per rad
+        std::vector<uint8_t> packed;   // Packad form
+        size_t rawBytes = 0;           // cells + ends innan packning
+        int lines = 0;
+        bool cold = false;             // Packat; cells och ends är frigjorda
+        uint64_t id = 0;               // Unikt, nyckel för uppackningscachen
+    };
+    using BlockPtr = std::shared_ptr<Block>;
+
+    size_t maxLines;
+    size_t lineCount = 0;
+    size_t firstLine = 0; // Glömda rader i det första blocket
+    size_t forgottenLines = 0;
+    std::deque<BlockPtr> blocks;
+    size_t handedOff = 0; // Block i början av blocks som lämnats till tråden
+    uint64_t nextId = 1;
+
+    // Bakgrundstråden packar block ur queue; blocks skyddas av mutex när en tråd
+    // byter form på ett block eller läser det
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<BlockPtr> queue;
+    std::thread worker;
+    bool stopping = false;
+
+    // Senast uppackade blocket för line()
+    mutable Block cached;
+
+    LineStore store; // Öppen med --scrollback-file
+
+    void trim();
+    void handOffOldBlocks();
+    void workerLoop();
+};
+
+#endif // SCROLLBACK_H
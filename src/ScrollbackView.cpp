@@ -0,0 +1,89 @@
+#include "ScrollbackView.h"
+
+#include <algorithm>
+#include <cstring>
+
+void ScrollbackView::resize(int cols_, int rows_) {
+    cols = std::max(cols_, 0);
+    rows = std::max(rows_, 0);
+    back = 0;
+    direction = 0;
+    slots.assign(static_cast<size_t>(std::max(1, rows * kCachePages)), Slot{});
+}
+
+long ScrollbackView::scrollBy(long delta, const Scrollback& history) {
+    const size_t size = history.size();
+    size_t target = back;
+    if (delta > 0) {
+        target = std::min(size, back + static_cast<size_t>(delta));
+    } else if (delta < 0) {
+        size_t up = static_cast<size_t>(-delta);
+        target = back > up ? back - up : 0;
+    }
+    target = std::min(target, size);
+    long moved = static_cast<long>(target) - static_cast<long>(back);
+    back = target;
+    if (moved != 0) direction = moved > 0 ? 1 : -1;
+    return moved;
+}
+
+int ScrollbackView::gridScrolled(const Scrollback& history) {
+    const size_t newEnd = history.forgotten() + history.size();
+    const size_t grew = newEnd - end;
+    end = newEnd;
+    if (back == 0) return 1;
+    if (grew != 1) return rows; // En rad kom aldrig fram till historiken; följden är en annan
+
+    // Samma översta rad som förut, utom när de äldsta raderna glömts under den
+    const size_t size = history.size();
+    if (back + 1 <= size) {
+        back++;
+        return 0;
+    }
+    back = size;
+    return 1;
+}
+
+const Cell* ScrollbackView::row(int y, const Scrollback& history, const CellGrid& grid, const Cell& blank) {
+    if (back == 0) return grid.row(y);
+    const size_t size = history.size();
+    const size_t index = size - std::min(back, size) + static_cast<size_t>(y);
+    if (index >= size) return grid.row(static_cast<int>(index - size));
+    return cachedLine(history.forgotten() + index, history, blank);
+}
+
+void ScrollbackView::prefetch(const Scrollback& history, const Cell& blank) {
+    if (direction == 0 || back == 0) return;
+    const size_t size = history.size();
+    const size_t top = size - std::min(back, size);
+    size_t first = 0, last = 0; // [first, last) i historiken
+    if (direction > 0) {
+        first = top > static_cast<size_t>(rows) ? top - rows : 0;
+        last = top;
+    } else {
+        first = std::min(size, top + rows);
+        last = std::min(size, first + rows);
+    }
+    for (size_t index = first; index < last; ++index) {
+        cachedLine(history.forgotten() + index, history, blank);
+    }
+    direction = 0;
+}
+
+const Cell* ScrollbackView::cachedLine(size_t line, const Scrollback& history, const Cell& blank) {
+    // Utfyllnaden beror på temat; byts det gäller inget i cachen längre
+    if (std::memcmp(&blank, &cachedBlank, sizeof(Cell)) != 0) {
+        for (Slot& slot : slots) slot.line = static_cast<size_t>(-1);
+        cachedBlank = blank;
+    }
+    Slot& slot = slots[line % slots.size()];
+    if (slot.line != line) {
+        history.line(line - history.forgotten(), scratch);
+        size_t count = std::min(scratch.size(), static_cast<size_t>(cols));
+        slot.cells.assign(static_cast<size_t>(cols), blank);
+        std::copy(scratch.begin(), scratch.begin() + count, slot.cells.begin());
+        slot.line = line;
+        decoded++;
+    }
+    return slot.cells.data();
+}
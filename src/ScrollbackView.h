@@ -0,0 +1,67 @@
+#ifndef SCROLLBACK_VIEW_H
+#define SCROLLBACK_VIEW_H
+
+#include <cstddef>
+#include <vector>
+
+#include "CellGrid.h"
+#include "Scrollback.h"
+
+// Vyn över historiken och rutnätet (mushjulet, Shift+PgUp/PgDn).
+//
+// Historiken och rutnätet bildar en följd av rader: historikens äldsta först, rutnätets
+// sista rad sist. Vyn visar rows rader ur följden och adresseras med offset, antal
+// rader från botten; 0 är det levande rutnätet som förut.
+//
+// Synliga rader ur historiken avkodas till en liten cache runt vyn (kCachePages sidor,
+// direktmappad på radens nummer), så en frame kostar högst en avkodning per synlig
+// rad oavsett hur lång historiken är eller om den är packad eller ligger på disk.
+// prefetch() avkodar sidan bortom vyn i den riktning den senast flyttades.
+class ScrollbackView {
+public:
+    static constexpr int kCachePages = 4; // Vyn, en sida på var sida om den och lite marginal
+
+    // Rutnätets storlek; tömmer cachen och går till botten
+    void resize(int cols, int rows);
+
+    size_t offset() const { return back; }
+    bool atBottom() const { return back == 0; }
+
+    // Flytta vyn delta rader bakåt i historiken (framåt om negativt), högst till
+    // historikens början och botten. Returnerar hur många rader den faktiskt flyttades.
+    long scrollBy(long delta, const Scrollback& history);
+    // Rutnätet har scrollat en rad och raden lagts i historiken. Vid botten följer vyn
+    // med, annars står den kvar på samma rader. Returnerar hur många rader innehållet
+    // flyttats uppåt; rows om det inte går att säga (allt ska ritas om).
+    int gridScrolled(const Scrollback& history);
+
+    // Synlig rad y (0 överst) med cols celler, historikens rader utfyllda med blank.
+    // Pekaren gäller till nästa anrop som kan avkoda en rad.
+    const Cell* row(int y, const Scrollback& history, const CellGrid& grid, const Cell& blank);
+    // Avkoda sidan bortom vyn i senaste scrollriktningen, så att nästa steg dit redan
+    // finns i cachen. Görs en gång per förflyttning.
+    void prefetch(const Scrollback& history, const Cell& blank);
+
+    // Rader som avkodats ur historiken sedan start
+    size_t decodedLines() const { return decoded; }
+
+private:
+    struct Slot {
+        size_t line = static_cast<size_t>(-1); // Radens nummer (Scrollback::forgotten() + index)
+        std::vector<Cell> cells;
+    };
+
+    int cols = 0;
+    int rows = 0;
+    size_t back = 0;       // offset()
+    size_t end = 0;        // Historikens forgotten() + size() vid senaste uppdateringen
+    int direction = 0;     // 1 bakåt, -1 framåt, 0 när prefetch redan gjorts
+    std::vector<Slot> slots;
+    std::vector<Cell> scratch;
+    Cell cachedBlank;
+    size_t decoded = 0;
+
+    const Cell* cachedLine(size_t line, const Scrollback& history, const Cell& blank);
+};
+
+#endif // SCROLLBACK_VIEW_H
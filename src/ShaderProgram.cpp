@@ -0,0 +1,292 @@
+#include "ShaderProgram.h"
+#include "Log.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+
+// ARB_get_program_binary (core i GL 4.1) finns inte i vår GLAD-profil
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace {
+
+typedef void (APIENTRYP PFN_GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length,
+                                              GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFN_ProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFN_ProgramParameteri)(GLuint program, GLenum pname, GLint value);
+
+PFN_GetProgramBinary pGetProgramBinary = nullptr;
+PFN_ProgramBinary pProgramBinary = nullptr;
+PFN_ProgramParameteri pProgramParameteri = nullptr;
+std::string cacheDir; // Tom = cachen avstängd
+
+constexpr uint32_t kCacheMagic = 0x42535444; // "DTSB"
+
+// Funktion för att läsa shader-kod från fil
+std::string readShaderFile(const std::string& filePath) {
+    std::ifstream shaderFile(filePath);
+    if (!shaderFile.is_open()) {
+        std::cerr << "ERROR::SHADER: Failed to open file: " << filePath << std::endl;
+        return "";
+    }
+    std::stringstream shaderStream;
+    shaderStream << shaderFile.rdbuf();
+    shaderFile.close();
+    return shaderStream.str();
+}
+
+GLuint compileShader(GLenum type, const std::string& source, const std::string& path) {
+    const char* code = source.c_str();
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &code, NULL);
+    glCompileShader(shader);
+
+    int success;
+    char infoLog[512];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cerr << "ERROR::SHADER::" << (type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT")
+                  << "::COMPILATION_FAILED\n" << path << "\n" << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// FNV-1a, 64 bitar: räcker för att skilja källkodsversioner åt
+uint64_t hashString(uint64_t hash, const std::string& data) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    hash ^= 0xFF; // Avgränsare så att "ab"+"c" != "a"+"bc"
+    hash *= 1099511628211ull;
+    return hash;
+}
+
+std::string glString(GLenum name) {
+    const GLubyte* s = glGetString(name);
+    return s ? reinterpret_cast<const char*>(s) : "";
+}
+
+std::string cachePath(const std::string& vertexSource, const std::string& fragmentSource) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashString(hash, vertexSource);
+    hash = hashString(hash, fragmentSource);
+    hash = hashString(hash, glString(GL_VENDOR));
+    hash = hashString(hash, glString(GL_RENDERER));
+    hash = hashString(hash, glString(GL_VERSION));
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(hash));
+    return cacheDir + "/" + name;
+}
+
+GLuint loadCachedProgram(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return 0;
+
+    uint32_t magic = 0, format = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    if (!file || magic != kCacheMagic) return 0;
+    std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (binary.empty()) return 0;
+
+    GLuint program = glCreateProgram();
+    pProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        // Drivrutinen vägrar binären (t.ex. efter uppdatering), kompilera om
+        glDeleteProgram(program);
+        std::remove(path.c_str());
+        return 0;
+    }
+    return program;
+}
+
+void storeCachedProgram(GLuint program, const std::string& path) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    pGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    // Skriv till temporär fil och byt namn, så att en avbruten skrivning aldrig syns
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return;
+        uint32_t magic = kCacheMagic, fmt = format;
+        file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        file.write(reinterpret_cast<const char*>(&fmt), sizeof(fmt));
+        file.write(binary.data(), binary.size());
+        if (!file) return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+}
+
+} // namespace
+
+bool ShaderProgram::load(const std::string& vertexPath, const std::string& fragmentPath) {
+    destroy();
+
+    std::string vertexSource = readShaderFile(vertexPath);
+    std::string fragmentSource = readShaderFile(fragmentPath);
+    if (vertexSource.empty() || fragmentSource.empty()) {
+        return false;
+    }
+
+    std::string binaryPath;
+    if (!cacheDir.empty()) {
+        binaryPath = cachePath(vertexSource, fragmentSource);
+        program = loadCachedProgram(binaryPath);
+        if (program != 0) {
+            LOG_DEBUG("Loaded cached shader program %s", binaryPath.c_str());
+            cacheUniforms();
+            return true;
+        }
+    }
+
+    GLuint vertex = compileShader(GL_VERTEX_SHADER, vertexSource, vertexPath);
+    if (vertex == 0) return false;
+    GLuint fragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource, fragmentPath);
+    if (fragment == 0) {
+        glDeleteShader(vertex); // Städa upp vertex shadern också
+        return false;
+    }
+
+    // Shader Program
+    program = glCreateProgram();
+    if (!binaryPath.empty()) {
+        pProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+
+    int success;
+    char infoLog[512];
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    // Radera shaders då de är länkade till programmet och inte längre behövs
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    if (!success) {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        glDeleteProgram(program); // Städa upp programmet
+        program = 0;
+        return false;
+    }
+
+    if (!binaryPath.empty()) {
+        storeCachedProgram(program, binaryPath);
+    }
+    cacheUniforms();
+    return true;
+}
+
+void ShaderProgram::destroy() {
+    if (program != 0) {
+        glDeleteProgram(program);
+        program = 0;
+    }
+    uniforms.clear();
+}
+
+GLint ShaderProgram::uniform(const char* name) const {
+    auto it = uniforms.find(name);
+    return it != uniforms.end() ? it->second : -1;
+}
+
+void ShaderProgram::cacheUniforms() {
+    uniforms.clear();
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()),
+                           &length, &size, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), length);
+        GLint location = glGetUniformLocation(program, name.c_str());
+        if (location < 0) continue; // Uniform blocks m.m.
+        uniforms[name] = location;
+
+        // "palette[0]" ska även gå att slå upp som "palette"
+        size_t bracket = name.find('[');
+        if (bracket != std::string::npos) {
+            uniforms[name.substr(0, bracket)] = location;
+        }
+    }
+}
+
+bool ShaderProgram::enableBinaryCache(GLADloadproc loader, const std::string& dir) {
+    cacheDir.clear();
+    if (dir.empty() || !loader) return false;
+
+    pGetProgramBinary = reinterpret_cast<PFN_GetProgramBinary>(loader("glGetProgramBinary"));
+    pProgramBinary = reinterpret_cast<PFN_ProgramBinary>(loader("glProgramBinary"));
+    pProgramParameteri = reinterpret_cast<PFN_ProgramParameteri>(loader("glProgramParameteri"));
+    if (!pGetProgramBinary || !pProgramBinary || !pProgramParameteri) {
+        LOG_INFO("Shader binary cache disabled: glGetProgramBinary not available");
+        return false;
+    }
+
+    // Vissa drivrutiner exporterar funktionerna men stöder inga binärformat
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    while (glGetError() != GL_NO_ERROR) {} // Okänd enum på äldre drivrutiner
+    if (formats <= 0) {
+        LOG_INFO("Shader binary cache disabled: driver reports no program binary formats");
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        LOG_WARN("Shader binary cache disabled: cannot create %s", dir.c_str());
+        return false;
+    }
+    cacheDir = dir;
+    return true;
+}
+
+std::string ShaderProgram::defaultCacheDir() {
+    if (const char* dir = std::getenv("DARKTERM_SHADER_CACHE")) {
+        return dir;
+    }
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+        if (*xdg) return std::string(xdg) + "/darkterm/shaders";
+    }
+    if (const char* home = std::getenv("HOME")) {
+#ifdef __APPLE__
+        return std::string(home) + "/Library/Caches/DarkTerm/shaders";
+#else
+        return std::string(home) + "/.cache/darkterm/shaders";
+#endif
+    }
+    return "";
+}
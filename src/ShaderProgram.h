@@ -0,0 +1,47 @@
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include <string>
+#include <map>
+
+#include <glad/glad.h>
+
+// Ett länkat GLSL-program med alla uniform-platser uppslagna vid länkning.
+//
+// Om binärcachen är aktiverad (enableBinaryCache) sparas länkade program med
+// glGetProgramBinary, nycklade på källkodens hash och drivrutinens identitet.
+// Nästa start laddas binären direkt och kompileringen hoppas över.
+class ShaderProgram {
+public:
+    ShaderProgram() = default;
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    // Läs, kompilera (eller ladda från cache) och länka. Kräver aktiv GL-kontext.
+    bool load(const std::string& vertexPath, const std::string& fragmentPath);
+    void destroy();
+
+    GLuint id() const { return program; }
+    bool valid() const { return program != 0; }
+    void use() const { glUseProgram(program); }
+
+    // Uniform-plats från cachen (-1 om den inte finns eller optimerats bort).
+    // Arrayer kan slås upp både som "namn" och "namn[0]".
+    GLint uniform(const char* name) const;
+
+    // Aktivera cachen för programbinärer i katalogen dir (skapas vid behov).
+    // loader används för att hämta glGetProgramBinary/glProgramBinary, som inte
+    // ingår i GL 3.3 core. Returnerar false om drivrutinen saknar stöd.
+    static bool enableBinaryCache(GLADloadproc loader, const std::string& dir);
+    // Standardkatalog: $DARKTERM_SHADER_CACHE, annars $XDG_CACHE_HOME/darkterm/shaders
+    // eller ~/.cache/darkterm/shaders. Tom sträng om ingen kan bestämmas.
+    static std::string defaultCacheDir();
+
+private:
+    GLuint program = 0;
+    std::map<std::string, GLint, std::less<>> uniforms; // less<> tillåter uppslag utan std::string
+
+    void cacheUniforms();
+};
+
+#endif // SHADER_PROGRAM_H
@@ -0,0 +1,361 @@
+#include "SoftwareRenderer.h"
+#include "GlyphAtlas.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Heltalsblandning som i GL: (fg * a + bg * (255 - a)) / 255, avrundat.
+// Summan ryms i 16 bitar (högst 255 * 255), så SIMD-vägarna kan räkna i 16-bitarslanes.
+inline uint8_t blendChannel(uint8_t fg, uint8_t bg, uint8_t a) {
+    unsigned x = fg * a + bg * (255u - a) + 128u;
+    return static_cast<uint8_t>((x + (x >> 8)) >> 8);
+}
+
+void blendScalar(uint32_t* dst, const uint8_t* alpha, int count, uint32_t fg, uint32_t bg) {
+    uint8_t f[4], b[4];
+    std::memcpy(f, &fg, 4);
+    std::memcpy(b, &bg, 4);
+    for (int i = 0; i < count; ++i) {
+        uint8_t out[4];
+        for (int c = 0; c < 4; ++c) out[c] = blendChannel(f[c], b[c], alpha[i]);
+        std::memcpy(&dst[i], out, 4);
+    }
+}
+
+// Täckningen är 0 eller 255: välj pixel, ingen aritmetik
+void selectScalar(uint32_t* dst, const uint8_t* alpha, int count, uint32_t fg, uint32_t bg) {
+    for (int i = 0; i < count; ++i) dst[i] = alpha[i] ? fg : bg;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+// Fyra täckningsvärden utspridda till fyra byte per pixel (a0 a0 a0 a0 a1 ...)
+inline __m128i spreadAlpha4(const uint8_t* alpha) {
+    int32_t bits;
+    std::memcpy(&bits, alpha, 4);
+    __m128i a = _mm_cvtsi32_si128(bits);
+    a = _mm_unpacklo_epi8(a, a);
+    return _mm_unpacklo_epi16(a, a);
+}
+
+// x / 255 avrundat, per 16-bitarslane
+inline __m128i div255(__m128i x) {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+inline __m128i blend4(__m128i a, __m128i fg16, __m128i bg16) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    __m128i lo = _mm_unpacklo_epi8(a, zero);
+    __m128i hi = _mm_unpackhi_epi8(a, zero);
+    lo = div255(_mm_add_epi16(_mm_mullo_epi16(fg16, lo), _mm_mullo_epi16(bg16, _mm_sub_epi16(full, lo))));
+    hi = div255(_mm_add_epi16(_mm_mullo_epi16(fg16, hi), _mm_mullo_epi16(bg16, _mm_sub_epi16(full, hi))));
+    return _mm_packus_epi16(lo, hi);
+}
+#endif
+
+#if defined(__AVX2__)
+inline __m256i div255(__m256i x) {
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+void blendRow(uint32_t* dst, const uint8_t* alpha, int count, uint32_t fg, uint32_t bg) {
+    const __m256i fg16 = _mm256_cvtepu8_epi16(_mm_set1_epi32(static_cast<int>(fg)));
+    const __m256i bg16 = _mm256_cvtepu8_epi16(_mm_set1_epi32(static_cast<int>(bg)));
+    const __m256i full = _mm256_set1_epi16(255);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Åtta pixlar: fyra per 256-bitarshalva, 16 bitar per kanal
+        __m256i lo = _mm256_cvtepu8_epi16(spreadAlpha4(alpha + i));
+        __m256i hi = _mm256_cvtepu8_epi16(spreadAlpha4(alpha + i + 4));
+        lo = div255(_mm256_add_epi16(_mm256_mullo_epi16(fg16, lo),
+                                     _mm256_mullo_epi16(bg16, _mm256_sub_epi16(full, lo))));
+        hi = div255(_mm256_add_epi16(_mm256_mullo_epi16(fg16, hi),
+                                     _mm256_mullo_epi16(bg16, _mm256_sub_epi16(full, hi))));
+        // packus packar inom 128-bitarslanes: återställ pixelordningen 0-7
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    for (; i + 4 <= count; i += 4) {
+        __m128i out = blend4(spreadAlpha4(alpha + i), _mm256_castsi256_si128(fg16), _mm256_castsi256_si128(bg16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+    }
+    blendScalar(dst + i, alpha + i, count - i, fg, bg);
+}
+
+void selectRow(uint32_t* dst, const uint8_t* alpha, int count, uint32_t fg, uint32_t bg) {
+    const __m256i fgv = _mm256_set1_epi32(static_cast<int>(fg));
+    const __m256i bgv = _mm256_set1_epi32(static_cast<int>(bg));
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(alpha + i)));
+        __m256i mask = _mm256_cmpgt_epi32(a, _mm256_setzero_si256());
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_blendv_epi8(bgv, fgv, mask));
+    }
+    selectScalar(dst + i, alpha + i, count - i, fg, bg);
+}
+
+#elif defined(__SSE2__)
+void blendRow(uint32_t* dst, const uint8_t* alpha, int count, uint32_t fg, uint32_t bg) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i fg16 = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(fg)), zero);
+    const __m128i bg16 = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(bg)), zero);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), blend4(spreadAlpha4(alpha + i), fg16, bg16));
+    }
+    blendScalar(dst + i, alpha + i, count - i, fg, bg);
+}
+
+void selectRow(uint32_t* dst, const uint8_t* alpha, int count, uint32_t fg, uint32_t bg) {
+    const __m128i fgv = _mm_set1_epi32(static_cast<int>(fg));
+    const __m128i bgv = _mm_set1_epi32(static_cast<int>(bg));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Täckningen är 0 eller 255, så den utspridda byten är redan en mask
+        __m128i mask = spreadAlpha4(alpha + i);
+        __m128i out = _mm_or_si128(_mm_and_si128(mask, fgv), _mm_andnot_si128(mask, bgv));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+    }
+    selectScalar(dst + i, alpha + i, count - i, fg, bg);
+}
+
+#elif defined(__ARM_NEON)
+// Fyra täckningsvärden utspridda till fyra byte per pixel
+inline uint8x16_t spreadAlpha4(const uint8_t* alpha) {
+    uint32_t bits;
+    std::memcpy(&bits, alpha, 4);
+    uint8x8_t a = vcreate_u8(bits);
+    uint8x8x2_t pairs = vzip_u8(a, a);
+    uint16x4x2_t quads = vzip_u16(vreinterpret_u16_u8(pairs.val[0]), vreinterpret_u16_u8(pairs.val[0]));
+    return vreinterpretq_u8_u16(vcombine_u16(quads.val[0], quads.val[1]));
+}
+
+void blendRow(uint32_t* dst, const uint8_t* alpha, int count, uint32_t fg, uint32_t bg) {
+    const uint8x8_t fgv = vreinterpret_u8_u32(vdup_n_u32(fg));
+    const uint8x8_t bgv = vreinterpret_u8_u32(vdup_n_u32(bg));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint8x16_t a = spreadAlpha4(alpha + i);
+        uint8x16_t inv = vmvnq_u8(a); // 255 - a
+        uint16x8_t lo = vmlal_u8(vmull_u8(fgv, vget_low_u8(a)), bgv, vget_low_u8(inv));
+        uint16x8_t hi = vmlal_u8(vmull_u8(fgv, vget_high_u8(a)), bgv, vget_high_u8(inv));
+        // (x + ((x + 128) >> 8) + 128) >> 8 == x / 255 avrundat
+        uint8x8_t outLo = vraddhn_u16(lo, vrshrq_n_u16(lo, 8));
+        uint8x8_t outHi = vraddhn_u16(hi, vrshrq_n_u16(hi, 8));
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), vcombine_u8(outLo, outHi));
+    }
+    blendScalar(dst + i, alpha + i, count - i, fg, bg);
+}
+
+void selectRow(uint32_t* dst, const uint8_t* alpha, int count, uint32_t fg, uint32_t bg) {
+    const uint8x16_t fgv = vreinterpretq_u8_u32(vdupq_n_u32(fg));
+    const uint8x16_t bgv = vreinterpretq_u8_u32(vdupq_n_u32(bg));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), vbslq_u8(spreadAlpha4(alpha + i), fgv, bgv));
+    }
+    selectScalar(dst + i, alpha + i, count - i, fg, bg);
+}
+
+#else
+void blendRow(uint32_t* dst, const uint8_t* alpha, int count, uint32_t fg, uint32_t bg) {
+    blendScalar(dst, alpha, count, fg, bg);
+}
+
+void selectRow(uint32_t* dst, const uint8_t* alpha, int count, uint32_t fg, uint32_t bg) {
+    selectScalar(dst, alpha, count, fg, bg);
+}
+#endif
+
+} // namespace
+
+SoftwareRenderer::SoftwareRenderer(unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    // Den anropande tråden ritar också, så poolen behöver en tråd mindre
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(&SoftwareRenderer::workerLoop, this);
+    }
+}
+
+SoftwareRenderer::~SoftwareRenderer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+uint32_t SoftwareRenderer::packColor(uint8_t r, uint8_t g, uint8_t b) {
+    const uint8_t bytes[4] = { r, g, b, 255 };
+    uint32_t color;
+    std::memcpy(&color, bytes, 4);
+    return color;
+}
+
+const char* SoftwareRenderer::simdName() {
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#elif defined(__ARM_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+bool SoftwareRenderer::resize(int cols_, int rows_, int cellWidth_, int cellHeight_) {
+    if (cols == cols_ && rows == rows_ && cellWidth == cellWidth_ && cellHeight == cellHeight_) {
+        return false;
+    }
+    cols = cols_;
+    rows = rows_;
+    cellWidth = cellWidth_;
+    cellHeight = cellHeight_;
+    imageWidth = cols * cellWidth;
+    imageHeight = rows * cellHeight;
+    image.assign(static_cast<size_t>(imageWidth) * imageHeight, packColor(0, 0, 0));
+    binaryFor = nullptr;
+    return true;
+}
+
+void SoftwareRenderer::render(const uint8_t* cells, const uint32_t palette[16], const GlyphAtlas& atlas,
+                              int firstRow, int rowCount) {
+    firstRow = std::max(firstRow, 0);
+    rowCount = std::min(rowCount, rows - firstRow);
+    if (rowCount <= 0 || atlas.getCellWidth() != cellWidth || atlas.getCellHeight() != cellHeight) return;
+    classifySlots(atlas);
+
+    // Några rader per band så att varje tråd får ett sammanhängande minnesområde
+    int threads = static_cast<int>(workers.size()) + 1;
+    int bands = std::min(rowCount, threads * 2);
+    run(bands, [&](int band) {
+        int begin = firstRow + rowCount * band / bands;
+        int end = firstRow + rowCount * (band + 1) / bands;
+        for (int row = begin; row < end; ++row) {
+            renderRow(cells, palette, atlas, row);
+        }
+    });
+}
+
+void SoftwareRenderer::scroll(int rowCount) {
+    if (rowCount == 0) return;
+    size_t shift = static_cast<size_t>(std::min(std::abs(rowCount), rows)) * cellHeight * imageWidth;
+    if (rowCount > 0) {
+        std::copy(image.begin() + shift, image.end(), image.begin());
+    } else {
+        std::copy_backward(image.begin(), image.end() - shift, image.end());
+    }
+}
+
+void SoftwareRenderer::fillCell(int col, int row, uint32_t color) {
+    if (col < 0 || col >= cols || row < 0 || row >= rows) return;
+    for (int y = 0; y < cellHeight; ++y) {
+        uint32_t* dst = &image[static_cast<size_t>(row * cellHeight + y) * imageWidth + col * cellWidth];
+        std::fill_n(dst, cellWidth, color);
+    }
+}
+
+void SoftwareRenderer::renderRow(const uint8_t* cells, const uint32_t palette[16], const GlyphAtlas& atlas, int row) {
+    const uint8_t* atlasPixels = atlas.getPixels().data();
+    const int atlasWidth = atlas.getWidth();
+    const uint8_t* cell = cells + static_cast<size_t>(row) * cols * 4;
+    for (int col = 0; col < cols; ++col, cell += 4) {
+        const uint8_t glyph = cell[0];
+        const uint32_t fg = palette[cell[1] & 0x0F];
+        const uint32_t bg = palette[cell[2] & 0x0F];
+        uint32_t* dst = &image[static_cast<size_t>(row) * cellHeight * imageWidth + col * cellWidth];
+
+        if (glyph == ' ' || !atlas.glyph(glyph).present) {
+            for (int y = 0; y < cellHeight; ++y, dst += imageWidth) std::fill_n(dst, cellWidth, bg);
+            continue;
+        }
+        const uint8_t* src = atlasPixels + static_cast<size_t>(glyph / GlyphAtlas::kColumns) * cellHeight * atlasWidth +
+                             (glyph % GlyphAtlas::kColumns) * cellWidth;
+        const bool binary = binarySlot[glyph];
+        for (int y = 0; y < cellHeight; ++y, dst += imageWidth, src += atlasWidth) {
+            if (binary) {
+                selectRow(dst, src, cellWidth, fg, bg);
+            } else {
+                blendRow(dst, src, cellWidth, fg, bg);
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::classifySlots(const GlyphAtlas& atlas) {
+    const uint8_t* pixels = atlas.getPixels().data();
+    if (binaryFor == pixels) return;
+    const int atlasWidth = atlas.getWidth();
+    for (int slot = 0; slot < GlyphAtlas::kGlyphCount; ++slot) {
+        bool binary = true;
+        const uint8_t* src = pixels + static_cast<size_t>(slot / GlyphAtlas::kColumns) * cellHeight * atlasWidth +
+                             (slot % GlyphAtlas::kColumns) * cellWidth;
+        for (int y = 0; y < cellHeight && binary; ++y, src += atlasWidth) {
+            binary = std::all_of(src, src + cellWidth, [](uint8_t a) { return a == 0 || a == 255; });
+        }
+        binarySlot[slot] = binary;
+    }
+    binaryFor = pixels;
+}
+
+void SoftwareRenderer::run(int bands, const std::function<void(int)>& work) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = work;
+        jobBands = bands;
+        nextBand = 0;
+        bandsLeft = bands;
+        generation++;
+    }
+    wake.notify_all();
+
+    int band = 0;
+    while (takeBand(band)) {
+        job(band);
+        std::lock_guard<std::mutex> lock(mutex);
+        bandsLeft--;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return bandsLeft == 0; });
+    job = nullptr;
+}
+
+bool SoftwareRenderer::takeBand(int& band) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (nextBand >= jobBands) return false;
+    band = nextBand++;
+    return true;
+}
+
+void SoftwareRenderer::workerLoop() {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        int band = 0;
+        while (takeBand(band)) {
+            job(band);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--bandsLeft == 0) finished.notify_one();
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class GlyphAtlas;
+
+// Ritar cellrutnätet på CPU:n till en RGBA8-bild, utan OpenGL.
+//
+// Indata är samma packning som grid-shaderns textur (4 byte per cell: glyph, fg, bg,
+// flaggor). Varje glyphrad blandas in med SIMD (AVX2, SSE2 eller NEON beroende på
+// vad kompilatorn får använda, annars skalärt). Glyphs vars täckning bara är 0 eller
+// 255 (bitmappsfonter) väljer pixel med en mask i stället för att blanda.
+// Raderna delas upp i band som ritas parallellt av en trådpool.
+//
+// Bilden har översta raden först och samma bytelayout som GL_RGBA/GL_UNSIGNED_BYTE.
+class SoftwareRenderer {
+public:
+    explicit SoftwareRenderer(unsigned threads = 0); // 0 = en tråd per kärna
+    ~SoftwareRenderer();
+    SoftwareRenderer(const SoftwareRenderer&) = delete;
+    SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+    // Färg i bildens bytelayout (r, g, b, 255)
+    static uint32_t packColor(uint8_t r, uint8_t g, uint8_t b);
+    // Vilken instruktionsuppsättning blandningen kompilerats för
+    static const char* simdName();
+
+    // Anpassa bilden till rutnätet. Returnerar true om den allokerats om (allt måste ritas).
+    bool resize(int cols, int rows, int cellWidth, int cellHeight);
+
+    // Rita raderna [firstRow, firstRow + rowCount) ur cells med paletten
+    void render(const uint8_t* cells, const uint32_t palette[16], const GlyphAtlas& atlas,
+                int firstRow, int rowCount);
+    // Flytta bilden rowCount rader uppåt (nedåt om negativt); de nya raderna ritas sedan med render()
+    void scroll(int rowCount);
+    // Fyll en cell med en färg (markören)
+    void fillCell(int col, int row, uint32_t color);
+
+    const std::vector<uint32_t>& pixels() const { return image; }
+    int width() const { return imageWidth; }
+    int height() const { return imageHeight; }
+
+private:
+    int cols = 0, rows = 0;
+    int cellWidth = 0, cellHeight = 0;
+    int imageWidth = 0, imageHeight = 0;
+    std::vector<uint32_t> image;
+
+    // Slots vars täckning bara är 0 eller 255; beräknas om när atlasen byts
+    const uint8_t* binaryFor = nullptr;
+    std::array<bool, 256> binarySlot{};
+
+    // Trådpool: run() delar ut band till arbetarna och den anropande tråden
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    std::function<void(int)> job;
+    int jobBands = 0, nextBand = 0, bandsLeft = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    void run(int bands, const std::function<void(int)>& work);
+    bool takeBand(int& band);
+    void workerLoop();
+    void classifySlots(const GlyphAtlas& atlas);
+    void renderRow(const uint8_t* cells, const uint32_t palette[16], const GlyphAtlas& atlas, int row);
+};
+
+#endif // SOFTWARE_RENDERER_H
@@ -0,0 +1,112 @@
+#include "StreamBuffer.h"
+#include "Log.h"
+
+#include <cstring>
+
+bool StreamBuffer::create(size_t capacity) {
+    if (capacity == 0) return false;
+    if (bufferID == 0) glGenBuffers(1, &bufferID);
+    size = capacity;
+    orphan();
+    orphans = 0; // Första allokeringen räknas inte
+    return bufferID != 0;
+}
+
+void StreamBuffer::destroy() {
+    for (Fence& fence : fences) {
+        glDeleteSync(fence.sync);
+    }
+    fences.clear();
+    if (bufferID != 0) {
+        glDeleteBuffers(1, &bufferID);
+        bufferID = 0;
+    }
+    size = head = frameBegin = frameBytes = 0;
+}
+
+size_t StreamBuffer::upload(const void* data, size_t bytes, size_t alignment) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+    if (bytes == 0) return 0;
+
+    // En enskild uppladdning som inte får plats: väx och börja om i ny lagring
+    if (bytes >= size) {
+        size_t grown = size * 2;
+        while (grown <= bytes) grown *= 2;
+        LOG_DEBUG("Stream buffer grown from %zu to %zu bytes", size, grown);
+        size = grown;
+        orphan();
+    }
+
+    size_t begin = (head + alignment - 1) / alignment * alignment;
+    if (begin + bytes > size) begin = 0; // Gå runt, resten av ringen blir utfyllnad
+    size_t used = (begin >= head ? begin - head : size - head + begin) + bytes;
+
+    releaseFences();
+    bool busy = frameBytes + used >= size; // Framen skulle skriva över sig själv
+    for (const Fence& fence : fences) {
+        if (busy) break;
+        busy = overlaps(fence, begin, begin + bytes);
+    }
+    if (busy) {
+        // GPU:n läser fortfarande området: byt lagring i stället för att vänta
+        orphan();
+        begin = 0;
+        used = bytes;
+    }
+
+    void* dst = glMapBufferRange(GL_COPY_WRITE_BUFFER, begin, bytes,
+                                 GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (dst) {
+        std::memcpy(dst, data, bytes);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    } else {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, begin, bytes, data); // Mappning misslyckades, skriv ändå
+    }
+
+    head = begin + bytes;
+    frameBytes += used;
+    uploaded += bytes;
+    return begin;
+}
+
+void StreamBuffer::endFrame() {
+    if (frameBytes == 0) return;
+    Fence fence;
+    fence.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fence.begin = frameBegin;
+    fence.end = head;
+    fences.push_back(fence);
+    frameBegin = head;
+    frameBytes = 0;
+}
+
+void StreamBuffer::orphan() {
+    // Ny lagring under samma namn; drivrutinen behåller den gamla tills GPU:n är klar med den
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+    for (Fence& fence : fences) {
+        glDeleteSync(fence.sync);
+    }
+    fences.clear();
+    head = frameBegin = frameBytes = 0;
+    orphans++;
+}
+
+// Släpp fences som GPU:n passerat. Frågar bara efter status, väntar aldrig.
+void StreamBuffer::releaseFences() {
+    while (!fences.empty()) {
+        GLint status = GL_UNSIGNALED;
+        glGetSynciv(fences.front().sync, GL_SYNC_STATUS, 1, NULL, &status);
+        if (status != GL_SIGNALED) break;
+        glDeleteSync(fences.front().sync);
+        fences.pop_front();
+    }
+}
+
+bool StreamBuffer::overlaps(const Fence& fence, size_t begin, size_t end) {
+    if (fence.begin <= fence.end) {
+        return begin < fence.end && fence.begin < end;
+    }
+    // Framen gick runt: [fence.begin, slutet) och [0, fence.end)
+    return end > fence.begin || begin < fence.end;
+}
@@ -0,0 +1,65 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstddef>
+#include <deque>
+
+#include <glad/glad.h>
+
+// Ringbuffert för data som laddas upp varje frame (instanser, rektanglar, texturrader).
+//
+// Skrivningar går via glMapBufferRange med UNSYNCHRONIZED | INVALIDATE_RANGE, så
+// drivrutinen varken väntar på GPU:n eller gör skuggkopior. Varje frames del av
+// ringen skyddas av en glFenceSync. Är området som ska skrivas fortfarande i bruk
+// av GPU:n byts hela lagringen ut (orphaning) i stället för att CPU:n väntar.
+//
+// Data som ska ligga kvar mellan frames kopieras vidare på GPU:n med
+// glCopyBufferSubData, eller läses direkt härifrån samma frame.
+class StreamBuffer {
+public:
+    StreamBuffer() = default;
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Kräver aktiv GL-kontext
+    bool create(size_t capacity);
+    void destroy();
+
+    GLuint buffer() const { return bufferID; }
+    size_t capacity() const { return size; }
+
+    // Kopiera bytes till ringen och returnera offset i buffer(). Bufferten lämnas
+    // bunden till GL_COPY_WRITE_BUFFER. Datan ska användas (ritas eller kopieras)
+    // innan nästa upload, som kan byta ut lagringen.
+    size_t upload(const void* data, size_t bytes, size_t alignment = 16);
+
+    // Anropas en gång per frame efter sista ritanropet som läser ringen.
+    void endFrame();
+
+    // Antal gånger lagringen bytts ut för att GPU:n inte hunnit ikapp (för statistik)
+    size_t orphanCount() const { return orphans; }
+    // Totalt antal bytes som laddats upp (för statistik)
+    size_t uploadedBytes() const { return uploaded; }
+
+private:
+    struct Fence {
+        GLsync sync = nullptr;
+        size_t begin = 0; // Framens område [begin, end), kan gå runt ringens slut
+        size_t end = 0;
+    };
+
+    GLuint bufferID = 0;
+    size_t size = 0;
+    size_t head = 0;       // Nästa lediga byte
+    size_t frameBegin = 0; // Där den pågående framens skrivningar började
+    size_t frameBytes = 0; // Skrivet (inklusive utfyllnad) sedan senaste endFrame
+    std::deque<Fence> fences; // Äldst först
+    size_t orphans = 0;
+    size_t uploaded = 0;
+
+    void orphan();
+    void releaseFences();
+    static bool overlaps(const Fence& fence, size_t begin, size_t end);
+};
+
+#endif // STREAM_BUFFER_H